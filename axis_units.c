@@ -0,0 +1,44 @@
+/**
+ * Per-axis unit conversion
+ * See axis_units.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ethercat.h"
+#include "axis_units.h"
+
+void axis_units_init(axis_units *u, uint32_t counts_per_rev, double gear_ratio, uint32_t rated_torque_mnm)
+{
+    memset(u, 0, sizeof(*u));
+    u->counts_per_rev = counts_per_rev;
+    u->gear_ratio = gear_ratio;
+    u->rated_torque_mnm = rated_torque_mnm;
+
+    // One output revolution is counts_per_rev * gear_ratio counts
+    double counts_per_out_rev = (double)counts_per_rev * gear_ratio;
+    u->rad_per_count = 2.0 * M_PI / counts_per_out_rev;
+    u->counts_per_rad = counts_per_out_rev / (2.0 * M_PI);
+    u->rads_per_cps = (float)u->rad_per_count;
+    u->cps_per_rads = (float)u->counts_per_rad;
+
+    // Per-mille of motor rated torque, multiplied up through the gearbox
+    if (rated_torque_mnm > 0)
+    {
+        double nm_per_unit = rated_torque_mnm / 1000.0 / 1000.0 * gear_ratio;
+        u->nm_per_unit = (float)nm_per_unit;
+        u->units_per_nm = (float)(1.0 / nm_per_unit);
+    }
+}
+
+int axis_units_read_rated_torque(axis_units *u, uint16_t slave)
+{
+    uint32 rated = 0;
+    int size = sizeof(rated);
+
+    if (ec_SDOread(slave, 0x6076, 0x00, FALSE, &size, &rated, EC_TIMEOUTRXM) <= 0 || rated == 0)
+        return 0;
+
+    axis_units_init(u, u->counts_per_rev, u->gear_ratio, etohl(rated));
+    return 1;
+}
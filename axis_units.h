@@ -0,0 +1,88 @@
+/**
+ * Per-axis unit conversion between SI and drive units
+ *
+ * CiA 402 drives exchange position in encoder counts, velocity in counts/s
+ * and torque in per-mille of the motor's rated torque (0x6076, mNm). The
+ * scale factors depend on the encoder resolution, the gear ratio and the
+ * rated torque, so they are computed once per axis by axis_units_init().
+ * The conversions below are then one multiply each, with no division:
+ *
+ *   position  rad   <-> counts      (double: multi-turn counts exceed float precision)
+ *   velocity  rad/s <-> counts/s    (float)
+ *   torque    Nm    <-> per-mille   (float)
+ *
+ * SI values are on the output side of the gearbox.
+ */
+
+#ifndef AXIS_UNITS_H
+#define AXIS_UNITS_H
+
+#include <stdint.h>
+#include <math.h>
+
+typedef struct
+{
+    // Configuration
+    uint32_t counts_per_rev;        // Encoder counts per motor revolution
+    double   gear_ratio;            // Motor revolutions per output revolution
+    uint32_t rated_torque_mnm;      // Motor rated torque (0x6076), mNm
+
+    // Precomputed scale factors
+    double   rad_per_count;
+    double   counts_per_rad;
+    float    rads_per_cps;          // rad/s per count/s
+    float    cps_per_rads;
+    float    nm_per_unit;           // Nm per per-mille of rated torque (motor side x gear)
+    float    units_per_nm;
+} axis_units;
+
+/**
+ * Compute the scale factors
+ * `rated_torque_mnm` may be 0 until axis_units_read_rated_torque() has run;
+ * torque conversions return 0 meanwhile.
+ */
+void axis_units_init(axis_units *u, uint32_t counts_per_rev, double gear_ratio, uint32_t rated_torque_mnm);
+
+/**
+ * Read the rated torque (0x6076) of `slave` over SDO and rescale
+ * Call in PRE-OP or SAFE-OP. Returns 1 on success; on failure the
+ * configured value is kept.
+ */
+int axis_units_read_rated_torque(axis_units *u, uint16_t slave);
+
+static inline double axis_units_pos_to_rad(const axis_units *u, int32_t counts)
+{
+    return counts * u->rad_per_count;
+}
+
+static inline int32_t axis_units_rad_to_pos(const axis_units *u, double rad)
+{
+    return (int32_t)lrint(rad * u->counts_per_rad);
+}
+
+static inline float axis_units_vel_to_rads(const axis_units *u, int32_t cps)
+{
+    return (float)cps * u->rads_per_cps;
+}
+
+static inline int32_t axis_units_rads_to_vel(const axis_units *u, float rads)
+{
+    return (int32_t)lrintf(rads * u->cps_per_rads);
+}
+
+static inline float axis_units_torque_to_nm(const axis_units *u, int16_t per_mille)
+{
+    return (float)per_mille * u->nm_per_unit;
+}
+
+static inline int16_t axis_units_nm_to_torque(const axis_units *u, float nm)
+{
+    float t = nm * u->units_per_nm;
+    if (t > INT16_MAX)
+        t = INT16_MAX;
+    else if (t < INT16_MIN)
+        t = INT16_MIN;
+    return (int16_t)lrintf(t);
+}
+
+#endif
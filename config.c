@@ -0,0 +1,541 @@
+/**
+ * Runtime configuration
+ * See config.h for the split between fixed structure and reloadable tunables.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "axis_units.h"
+
+#define DEFAULT_CYCLE_US        2000
+#define DEFAULT_STATUS_MS       1000
+#define DEFAULT_SM_WATCHDOG_MS  20
+#define DEFAULT_SETPOINT_CYCLES 10
+#define DEFAULT_STOP_DECEL      100.0
+#define DEFAULT_STOP_TIMEOUT_MS 2000
+#define DEFAULT_COUNTS_PER_REV  131072
+#define DEFAULT_TARGET_RPM      10.0
+#define DEFAULT_MAX_RPM         100.0
+#define DEFAULT_MAX_TORQUE      1000
+
+// Parse result before it is split into the two published structures
+typedef struct
+{
+    config_rt rt;
+    uint32_t  status_ms;
+    uint32_t  setpoint_timeout_cycles;
+    double    target_rpm[CONFIG_MAX_AXES];
+    double    max_rpm[CONFIG_MAX_AXES];
+    uint32_t  max_torque[CONFIG_MAX_AXES];
+} config_file;
+
+static config_rt rt_config;
+static char config_path[256];
+static uint64_t generation;
+
+static _Atomic(config_params *) current = NULL;
+static atomic_uint_fast64_t rt_seen = 0;
+
+// Replaced copies the cyclic task may still hold, reload thread only;
+// each is free once the cyclic task has seen generation `until`
+typedef struct retired_params
+{
+    config_params         *params;
+    uint64_t               until;
+    struct retired_params *next;
+} retired_params;
+static retired_params *retired;
+
+static sem_t reload_sem;
+static pthread_t reload_thread;
+static atomic_int reload_running = 0;
+
+static void axis_defaults(config_file *f, int axis)
+{
+    config_axis *a = &f->rt.axis[axis];
+
+    a->slave = axis + 1;
+    a->mode = CONFIG_MODE_CSV;
+    a->counts_per_rev = DEFAULT_COUNTS_PER_REV;
+    a->gear_ratio = 1.0;
+    a->rated_torque_mnm = 0;
+    a->stop_decel_rpm_s = DEFAULT_STOP_DECEL;
+    f->target_rpm[axis] = DEFAULT_TARGET_RPM;
+    f->max_rpm[axis] = DEFAULT_MAX_RPM;
+    f->max_torque[axis] = DEFAULT_MAX_TORQUE;
+}
+
+static void defaults(config_file *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->rt.cycle_ns = DEFAULT_CYCLE_US * 1000;
+    f->rt.cpu = -1;
+    f->rt.sm_watchdog_ms = DEFAULT_SM_WATCHDOG_MS;
+    f->rt.stop_mode = CONFIG_STOP_RAMP;
+    f->rt.stop_timeout_ms = DEFAULT_STOP_TIMEOUT_MS;
+    f->status_ms = DEFAULT_STATUS_MS;
+    f->setpoint_timeout_cycles = DEFAULT_SETPOINT_CYCLES;
+}
+
+static char *trim(char *s)
+{
+    while (isspace((unsigned char)*s))
+        s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    return s;
+}
+
+static int parse_number(const char *value, double *out)
+{
+    char *end;
+    *out = strtod(value, &end);
+    return end != value && *trim(end) == '\0';
+}
+
+/**
+ * Apply one key = value line; `axis` is -1 in the global section
+ */
+static int set_key(config_file *f, int axis, const char *key, const char *value)
+{
+    double v;
+
+    if (axis < 0)
+    {
+        if (strcmp(key, "interface") == 0)
+        {
+            if (strlen(value) >= sizeof(f->rt.interface))
+                return 0;
+            strcpy(f->rt.interface, value);
+            return 1;
+        }
+        if (strcmp(key, "stop_mode") == 0)
+        {
+            if (strcmp(value, "ramp") == 0)
+                f->rt.stop_mode = CONFIG_STOP_RAMP;
+            else if (strcmp(value, "quickstop") == 0)
+                f->rt.stop_mode = CONFIG_STOP_QUICK;
+            else
+                return 0;
+            return 1;
+        }
+        if (!parse_number(value, &v))
+            return 0;
+        if (strcmp(key, "cycle_us") == 0)
+            f->rt.cycle_ns = (uint32_t)(v * 1000);
+        else if (strcmp(key, "cpu") == 0)
+            f->rt.cpu = (int)v;
+        else if (strcmp(key, "rt_priority") == 0)
+            f->rt.rt_priority = (int)v;
+        else if (strcmp(key, "sm_watchdog_ms") == 0)
+            f->rt.sm_watchdog_ms = (uint32_t)v;
+        else if (strcmp(key, "stop_timeout_ms") == 0)
+            f->rt.stop_timeout_ms = (uint32_t)v;
+        else if (strcmp(key, "status_ms") == 0)
+            f->status_ms = (uint32_t)v;
+        else if (strcmp(key, "setpoint_timeout_cycles") == 0)
+            f->setpoint_timeout_cycles = (uint32_t)v;
+        else
+            return 0;
+        return 1;
+    }
+
+    config_axis *a = &f->rt.axis[axis];
+    if (strcmp(key, "mode") == 0)
+    {
+        if (strcmp(value, "csv") != 0)
+            return 0;
+        a->mode = CONFIG_MODE_CSV;
+        return 1;
+    }
+    if (!parse_number(value, &v))
+        return 0;
+    if (strcmp(key, "slave") == 0)
+        a->slave = (uint16_t)v;
+    else if (strcmp(key, "counts_per_rev") == 0)
+        a->counts_per_rev = (uint32_t)v;
+    else if (strcmp(key, "gear_ratio") == 0)
+        a->gear_ratio = v;
+    else if (strcmp(key, "rated_torque_mnm") == 0)
+        a->rated_torque_mnm = (uint32_t)v;
+    else if (strcmp(key, "stop_decel_rpm_s") == 0)
+        a->stop_decel_rpm_s = v;
+    else if (strcmp(key, "target_rpm") == 0)
+        f->target_rpm[axis] = v;
+    else if (strcmp(key, "max_rpm") == 0)
+        f->max_rpm[axis] = v;
+    else if (strcmp(key, "max_torque") == 0)
+        f->max_torque[axis] = (uint32_t)v;
+    else
+        return 0;
+    return 1;
+}
+
+static int parse_file(const char *path, config_file *f)
+{
+    char line[256];
+    int lineno = 0;
+    int axis = -1;
+    int ok = 1;
+
+    defaults(f);
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        char *s = trim(line);
+        if (*s == '\0')
+            continue;
+
+        if (strcmp(s, "[axis]") == 0)
+        {
+            if (f->rt.naxes == CONFIG_MAX_AXES)
+            {
+                printf("%s:%d: more than %d axes\n", path, lineno, CONFIG_MAX_AXES);
+                ok = 0;
+                break;
+            }
+            axis = f->rt.naxes++;
+            axis_defaults(f, axis);
+            continue;
+        }
+
+        char *eq = strchr(s, '=');
+        if (eq == NULL)
+        {
+            printf("%s:%d: expected key = value\n", path, lineno);
+            ok = 0;
+            continue;
+        }
+        *eq = '\0';
+        char *key = trim(s);
+        char *value = trim(eq + 1);
+
+        if (!set_key(f, axis, key, value))
+        {
+            printf("%s:%d: invalid %s '%s'\n", path, lineno, key, value);
+            ok = 0;
+        }
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+static int validate(const config_file *f)
+{
+    int ok = 1;
+    uint32_t cycle_us = f->rt.cycle_ns / 1000;
+
+    if (cycle_us < 125 || cycle_us > 10000 || f->rt.cycle_ns % 1000)
+    {
+        printf("Config: cycle_us must be 125..10000 (got %u)\n", cycle_us);
+        ok = 0;
+    }
+    if (f->rt.rt_priority < 0 || f->rt.rt_priority > 99)
+    {
+        printf("Config: rt_priority must be 0..99\n");
+        ok = 0;
+    }
+    if (f->status_ms < 10)
+    {
+        printf("Config: status_ms must be at least 10\n");
+        ok = 0;
+    }
+    if (f->rt.sm_watchdog_ms != 0 &&
+        (f->rt.sm_watchdog_ms * 1000 < 2 * cycle_us || f->rt.sm_watchdog_ms > 6500))
+    {
+        printf("Config: sm_watchdog_ms must be 0 or from two cycles up to 6500\n");
+        ok = 0;
+    }
+    if (f->rt.stop_timeout_ms < 10 || f->rt.stop_timeout_ms > 60000)
+    {
+        printf("Config: stop_timeout_ms must be 10..60000\n");
+        ok = 0;
+    }
+    if (f->setpoint_timeout_cycles < 1)
+    {
+        printf("Config: setpoint_timeout_cycles must be at least 1\n");
+        ok = 0;
+    }
+    if (f->rt.naxes == 0)
+    {
+        printf("Config: no [axis] section\n");
+        ok = 0;
+    }
+
+    for (int i = 0; i < f->rt.naxes; i++)
+    {
+        const config_axis *a = &f->rt.axis[i];
+
+        if (a->slave < 1 || a->counts_per_rev == 0 || !(a->gear_ratio > 0))
+        {
+            printf("Config: axis %d needs slave >= 1, counts_per_rev > 0, gear_ratio > 0\n", i + 1);
+            ok = 0;
+        }
+        if (!(a->stop_decel_rpm_s > 0))
+        {
+            printf("Config: axis %d stop_decel_rpm_s must be > 0\n", i + 1);
+            ok = 0;
+        }
+        if (!(f->max_rpm[i] > 0) || f->target_rpm[i] > f->max_rpm[i] || f->target_rpm[i] < -f->max_rpm[i])
+        {
+            printf("Config: axis %d target_rpm %.1f outside max_rpm %.1f\n",
+                   i + 1, f->target_rpm[i], f->max_rpm[i]);
+            ok = 0;
+        }
+        if (f->max_torque[i] > 5000)
+        {
+            printf("Config: axis %d max_torque %u above 5000 per-mille\n", i + 1, f->max_torque[i]);
+            ok = 0;
+        }
+        for (int j = 0; j < i; j++)
+        {
+            if (f->rt.axis[j].slave == a->slave)
+            {
+                printf("Config: slave %u used by two axes\n", a->slave);
+                ok = 0;
+            }
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * Build a tunables block, converted to drive units
+ */
+static config_params *build_params(const config_file *f)
+{
+    config_params *p = aligned_alloc(64, sizeof(config_params));
+    if (p == NULL)
+        return NULL;
+
+    memset(p, 0, sizeof(*p));
+    p->generation = ++generation;
+    p->status_cycles = (uint32_t)((uint64_t)f->status_ms * 1000000 / f->rt.cycle_ns);
+    if (p->status_cycles == 0)
+        p->status_cycles = 1;
+    p->setpoint_timeout_ns = (int64_t)f->setpoint_timeout_cycles * f->rt.cycle_ns;
+
+    for (int i = 0; i < f->rt.naxes; i++)
+    {
+        axis_units u;
+        axis_units_init(&u, rt_config.axis[i].counts_per_rev, rt_config.axis[i].gear_ratio, 0);
+
+        p->axis[i].target_rpm = f->target_rpm[i];
+        p->axis[i].max_rpm = f->max_rpm[i];
+        p->axis[i].max_torque = f->max_torque[i];
+        p->axis[i].target_velocity = axis_units_rads_to_vel(&u, f->target_rpm[i] * 2.0 * M_PI / 60.0);
+        p->axis[i].max_velocity = axis_units_rads_to_vel(&u, f->max_rpm[i] * 2.0 * M_PI / 60.0);
+
+        // validate() keeps the RPM in range; this catches rounding of the conversion
+        if (p->axis[i].target_velocity > p->axis[i].max_velocity)
+            p->axis[i].target_velocity = p->axis[i].max_velocity;
+        else if (p->axis[i].target_velocity < -p->axis[i].max_velocity)
+            p->axis[i].target_velocity = -p->axis[i].max_velocity;
+    }
+    return p;
+}
+
+int config_load(const char *path)
+{
+    config_file f;
+
+    if (path == NULL)
+    {
+        defaults(&f);
+        f.rt.naxes = 1;
+        axis_defaults(&f, 0);
+        config_path[0] = '\0';
+    }
+    else
+    {
+        if (!parse_file(path, &f))
+            return 0;
+        snprintf(config_path, sizeof(config_path), "%s", path);
+    }
+
+    if (!validate(&f))
+        return 0;
+
+    rt_config = f.rt;
+    config_params *p = build_params(&f);
+    if (p == NULL)
+        return 0;
+
+    free(atomic_exchange(&current, p));
+    return 1;
+}
+
+const config_rt *config_get(void)
+{
+    return &rt_config;
+}
+
+const config_axis *config_axis_for_slave(uint16_t slave)
+{
+    for (int i = 0; i < rt_config.naxes; i++)
+    {
+        if (rt_config.axis[i].slave == slave)
+            return &rt_config.axis[i];
+    }
+    return NULL;
+}
+
+const config_params *config_params_acquire(void)
+{
+    config_params *p = atomic_load_explicit(&current, memory_order_acquire);
+    atomic_store_explicit(&rt_seen, p->generation, memory_order_release);
+    return p;
+}
+
+/**
+ * Free the retired copies the cyclic task has moved past (all of them
+ * with `all`, once it no longer reads parameters)
+ */
+static void free_retired(int all)
+{
+    uint64_t seen = atomic_load(&rt_seen);
+
+    for (retired_params **r = &retired; *r != NULL;)
+    {
+        if (all || seen >= (*r)->until)
+        {
+            retired_params *done = *r;
+            *r = done->next;
+            free(done->params);
+            free(done);
+        }
+        else
+        {
+            r = &(*r)->next;
+        }
+    }
+}
+
+static void reload(void)
+{
+    config_file f;
+
+    if (!parse_file(config_path, &f) || !validate(&f))
+    {
+        printf("⚠ Config: reload of %s rejected, keeping current values\n", config_path);
+        return;
+    }
+
+    // Structure is fixed at startup; only tunables change
+    if (strcmp(f.rt.interface, rt_config.interface) != 0 || f.rt.cycle_ns != rt_config.cycle_ns ||
+        f.rt.cpu != rt_config.cpu || f.rt.rt_priority != rt_config.rt_priority ||
+        f.rt.sm_watchdog_ms != rt_config.sm_watchdog_ms || f.rt.stop_mode != rt_config.stop_mode ||
+        f.rt.stop_timeout_ms != rt_config.stop_timeout_ms ||
+        f.rt.naxes != rt_config.naxes || memcmp(f.rt.axis, rt_config.axis, sizeof(f.rt.axis)) != 0)
+        printf("⚠ Config: interface, cycle, CPU and axis setup changes need a restart, ignored\n");
+
+    config_params *p = build_params(&f);
+    if (p == NULL)
+        return;
+
+    config_params *old = atomic_exchange_explicit(&current, p, memory_order_acq_rel);
+
+    // Free the old copy once the cyclic task has moved on (bounded wait);
+    // if it has not, keep it for a later reload or config_reload_stop()
+    for (int i = 0; i < 1000 && atomic_load(&rt_seen) < p->generation; i++)
+    {
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+    retired_params *r = malloc(sizeof(*r));
+    if (r != NULL)
+    {
+        r->params = old;
+        r->until = p->generation;
+        r->next = retired;
+        retired = r;
+    }
+    else
+    {
+        // Nowhere to park the old copy: wait for the cyclic task after all.
+        // Once the reload thread is stopping, the cyclic loop is over.
+        while (atomic_load(&rt_seen) < p->generation && atomic_load(&reload_running))
+        {
+            struct timespec ts = { 0, 1000000 };
+            nanosleep(&ts, NULL);
+        }
+        free(old);
+    }
+    free_retired(0);
+
+    printf("✓ Config: reloaded %s (generation %llu)\n", config_path, (unsigned long long)p->generation);
+    for (int i = 0; i < rt_config.naxes; i++)
+        printf("    Axis %d: target %.1f RPM, max %.1f RPM, max torque %u\n",
+               i + 1, p->axis[i].target_rpm, p->axis[i].max_rpm, p->axis[i].max_torque);
+}
+
+static void *reload_main(void *arg)
+{
+    (void)arg;
+
+    while (atomic_load(&reload_running))
+    {
+        sem_wait(&reload_sem);
+        if (!atomic_load(&reload_running))
+            break;
+        reload();
+    }
+
+    return NULL;
+}
+
+void config_request_reload(void)
+{
+    if (atomic_load(&reload_running))
+        sem_post(&reload_sem);
+}
+
+int config_reload_start(void)
+{
+    if (config_path[0] == '\0')
+        return 1;
+
+    sem_init(&reload_sem, 0, 0);
+    atomic_store(&reload_running, 1);
+    if (pthread_create(&reload_thread, NULL, reload_main, NULL) != 0)
+    {
+        atomic_store(&reload_running, 0);
+        return 0;
+    }
+    return 1;
+}
+
+void config_reload_stop(void)
+{
+    if (!atomic_load(&reload_running))
+        return;
+
+    atomic_store(&reload_running, 0);
+    sem_post(&reload_sem);
+    pthread_join(reload_thread, NULL);
+    sem_destroy(&reload_sem);
+
+    // Called once the cyclic loop is over: nothing reads the old copies
+    free_retired(1);
+}
@@ -0,0 +1,114 @@
+/**
+ * Runtime configuration
+ *
+ * A key = value file with one [axis] section per drive, parsed and
+ * validated once at startup (see motor_control.conf). It yields two
+ * structures:
+ *
+ *   config_rt      Structure of the setup: interface, cycle time, CPU
+ *                  affinity, per-axis slave, mode and scaling. Fixed for
+ *                  the lifetime of the process; read without locks.
+ *
+ *   config_params  Tunables: targets, limits, status interval. They are
+ *                  pre-converted to drive units, so the cyclic task only
+ *                  copies them. A reload (SIGHUP) parses the file again on a
+ *                  background thread and publishes a new copy with one
+ *                  atomic pointer swap. The cyclic task picks it up with
+ *                  config_params_acquire() at the start of a cycle.
+ *
+ * A reload that fails validation, or that changes config_rt fields, is
+ * reported and the running values are kept.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include <net/if.h>
+
+#define CONFIG_MAX_AXES  8
+
+// CiA 402 modes of operation (0x6060) the cyclic task implements
+#define CONFIG_MODE_CSV  9
+
+// Shutdown: host-side velocity ramp, or the drive's quick stop (0x605A / 0x6085)
+#define CONFIG_STOP_RAMP   0
+#define CONFIG_STOP_QUICK  1
+
+typedef struct
+{
+    uint16_t slave;
+    int8_t   mode;
+    uint32_t counts_per_rev;
+    double   gear_ratio;
+    uint32_t rated_torque_mnm;      // 0 = read from 0x6076
+    double   stop_decel_rpm_s;      // Shutdown ramp and quick-stop deceleration (0x6085)
+} config_axis;
+
+typedef struct
+{
+    char        interface[IFNAMSIZ];    // Empty = auto-detect
+    uint32_t    cycle_ns;
+    int         cpu;                    // -1 = no affinity
+    int         rt_priority;            // SCHED_FIFO priority, 0 = leave as is
+    uint32_t    sm_watchdog_ms;         // Slave SM watchdog, 0 = ESC default
+    int         stop_mode;              // CONFIG_STOP_*
+    uint32_t    stop_timeout_ms;        // Longest wait for standstill before disabling
+    int         naxes;
+    config_axis axis[CONFIG_MAX_AXES];
+} config_rt;
+
+typedef struct
+{
+    double   target_rpm;
+    double   max_rpm;
+    uint16_t max_torque;                // Per-mille of rated torque (0x6072)
+    int32_t  target_velocity;           // Drive units, clamped to max_rpm
+    int32_t  max_velocity;              // max_rpm in drive units
+} config_axis_params;
+
+typedef struct __attribute__((aligned(64)))
+{
+    uint64_t           generation;
+    uint32_t           status_cycles;   // Status line every N cycles
+    int64_t            setpoint_timeout_ns; // External setpoint older than this: quick stop
+    config_axis_params axis[CONFIG_MAX_AXES];
+} config_params;
+
+/**
+ * Load and validate `path`, or the built-in defaults if `path` is NULL
+ * Returns 1 on success; prints each problem and returns 0 otherwise.
+ */
+int config_load(const char *path);
+
+/**
+ * The immutable part (valid after config_load())
+ */
+const config_rt *config_get(void);
+
+/**
+ * Axis configured for `slave`, or NULL
+ */
+const config_axis *config_axis_for_slave(uint16_t slave);
+
+/**
+ * Current tunables, for the cyclic task
+ * One atomic load; also tells the reload thread that older copies are no
+ * longer in use. The returned copy stays valid until the next call.
+ */
+const config_params *config_params_acquire(void);
+
+/**
+ * Start / stop the reload thread (only useful when loaded from a file)
+ * Stop once the cyclic task no longer calls config_params_acquire(); it
+ * frees the replaced copies still held back.
+ */
+int config_reload_start(void);
+void config_reload_stop(void);
+
+/**
+ * Ask for a reload; async-signal-safe (call from the SIGHUP handler)
+ */
+void config_request_reload(void);
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * Cyclic task scheduler
+ * See cycle.h for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "cycle.h"
+
+#define NSEC_PER_SEC 1000000000LL
+
+int64_t cycle_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+int cycle_set_rt(int cpu, int priority)
+{
+    int ok = 1;
+
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err)
+        {
+            printf("  Warning: cannot pin cyclic task to CPU %d: %s\n", cpu, strerror(err));
+            ok = 0;
+        }
+    }
+
+    if (priority > 0)
+    {
+        struct sched_param param = { .sched_priority = priority };
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err)
+        {
+            printf("  Warning: cannot set SCHED_FIFO priority %d: %s\n", priority, strerror(err));
+            ok = 0;
+        }
+    }
+
+    return ok;
+}
+
+void cycle_init(cycle_sched *sched, int64_t period_ns, int64_t rx_budget_ns)
+{
+    sched->period_ns = period_ns;
+    sched->rx_budget_ns = rx_budget_ns;
+    sched->start_ns = cycle_now_ns();
+    sched->next_ns = sched->start_ns + period_ns;
+    sched->overruns = 0;
+}
+
+void cycle_wait(cycle_sched *sched)
+{
+    struct timespec ts;
+
+    ts.tv_sec = sched->next_ns / NSEC_PER_SEC;
+    ts.tv_nsec = sched->next_ns % NSEC_PER_SEC;
+    // Returns the error rather than setting errno; only a signal is worth a retry
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+
+    int64_t now = cycle_now_ns();
+    if (now - sched->next_ns > sched->period_ns)
+    {
+        // Missed at least one whole cycle: re-anchor instead of bursting to catch up
+        sched->overruns++;
+        sched->next_ns = now;
+    }
+
+    sched->start_ns = sched->next_ns;
+    sched->next_ns += sched->period_ns;
+}
+
+int cycle_rx_timeout_us(const cycle_sched *sched)
+{
+    int64_t left = sched->start_ns + sched->rx_budget_ns - cycle_now_ns();
+    return left > 0 ? (int)(left / 1000) : 0;
+}
+
+int cycle_left_us(const cycle_sched *sched)
+{
+    int64_t left = sched->next_ns - cycle_now_ns();
+    return left > 0 ? (int)(left / 1000) : 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * Cyclic task scheduler
+ *
+ * Keeps the cyclic task on an absolute CLOCK_MONOTONIC grid (no drift from
+ * processing time) and derives per-cycle deadlines from it. The receive
+ * deadline bounds how long a cycle may wait for its frame, so a late or
+ * lost frame never eats into the compute window.
+ */
+
+#ifndef CYCLE_H
+#define CYCLE_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    int64_t  period_ns;
+    int64_t  rx_budget_ns;     // Receive deadline, relative to cycle start
+    int64_t  start_ns;         // Start of the current cycle
+    int64_t  next_ns;          // Start of the next cycle
+    uint64_t overruns;         // Cycles that started late by more than one period
+} cycle_sched;
+
+/**
+ * Current CLOCK_MONOTONIC time in nanoseconds
+ */
+int64_t cycle_now_ns(void);
+
+/**
+ * Pin the calling thread to `cpu` (-1: leave) and run it SCHED_FIFO at
+ * `priority` (0: leave)
+ * Returns 1 if everything requested was applied.
+ */
+int cycle_set_rt(int cpu, int priority);
+
+/**
+ * Start the grid one period from now
+ */
+void cycle_init(cycle_sched *sched, int64_t period_ns, int64_t rx_budget_ns);
+
+/**
+ * Sleep until the next cycle boundary and make it the current cycle
+ * If the boundary has already passed by a full period the grid is
+ * re-anchored to now and the overrun is counted.
+ */
+void cycle_wait(cycle_sched *sched);
+
+/**
+ * Microseconds left until this cycle's receive deadline (0 if passed)
+ * Suitable as the timeout argument of ec_receive_processdata().
+ */
+int cycle_rx_timeout_us(const cycle_sched *sched);
+
+/**
+ * Microseconds left until the next cycle boundary (0 if passed)
+ * Bounds work done after the compute step, e.g. slow group exchanges.
+ */
+int cycle_left_us(const cycle_sched *sched);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Raw EtherCAT datagram helpers
+ * See datagram.h.
+ */
+
+#include <string.h>
+#include "datagram.h"
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+int datagram_build(datagram *d, uint8_t cmd, uint16_t adp, uint16_t ado, const void *data, uint16_t len)
+{
+    if (len > DATAGRAM_MAX_DATA)
+        return 0;
+
+    memset(d, 0, sizeof(*d));
+    d->bytes[0] = cmd;
+    put16(&d->bytes[2], adp);
+    put16(&d->bytes[4], ado);
+    put16(&d->bytes[6], len);
+    memcpy(&d->bytes[DATAGRAM_HDR], data, len);
+    d->length = DATAGRAM_HDR + len + DATAGRAM_WKC;
+    return 1;
+}
+
+int datagram_frame(uint8_t *frame, const datagram *d, uint8_t idx)
+{
+    uint8_t *ecat = frame + DATAGRAM_ETH_HDR;
+
+    // EtherCAT header: length, type 1 (datagrams)
+    put16(ecat, (uint16_t)(d->length | (1 << 12)));
+    memcpy(ecat + DATAGRAM_ECAT_HDR, d->bytes, d->length);
+    ecat[DATAGRAM_ECAT_HDR + 1] = idx;
+    return DATAGRAM_ETH_HDR + DATAGRAM_ECAT_HDR + d->length;
+}
+
+int datagram_append(uint8_t *frame, int *frame_len, int max_len, const datagram *d)
+{
+    uint8_t *ecat = frame + DATAGRAM_ETH_HDR;
+    int pos = DATAGRAM_ETH_HDR + DATAGRAM_ECAT_HDR;
+    int last;
+
+    if (*frame_len + d->length > max_len)
+        return 0;
+
+    // Find the end of the last datagram, which must be the end of the frame
+    for (;;)
+    {
+        if (pos + DATAGRAM_HDR + DATAGRAM_WKC > *frame_len)
+            return 0;
+        uint16_t dlen = get16(&frame[pos + 6]);
+        last = pos;
+        pos += DATAGRAM_HDR + (dlen & DATAGRAM_LEN_MASK) + DATAGRAM_WKC;
+        if (!(dlen & DATAGRAM_MORE_FOLLOWS))
+            break;
+    }
+    if (pos != *frame_len)
+        return 0;
+
+    put16(&frame[last + 6], get16(&frame[last + 6]) | DATAGRAM_MORE_FOLLOWS);
+    memcpy(&frame[pos], d->bytes, d->length);
+    frame[pos + 1] = frame[DATAGRAM_ETH_HDR + DATAGRAM_ECAT_HDR + 1];
+
+    uint16_t ecat_hdr = get16(ecat);
+    put16(ecat, (uint16_t)((ecat_hdr & ~DATAGRAM_LEN_MASK) | ((ecat_hdr & DATAGRAM_LEN_MASK) + d->length)));
+    *frame_len += d->length;
+    return pos + DATAGRAM_HDR;
+}
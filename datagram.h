@@ -0,0 +1,64 @@
+/**
+ * Raw EtherCAT datagram helpers
+ *
+ * Builds a datagram once (header, data, working counter) so that putting
+ * it on the wire later is a single copy. No SOEM dependency, so
+ * benchmark tools can use the same code as the master.
+ *
+ * Frame layout (little endian):
+ *   Ethernet header (14) | EtherCAT header (2: length:11, type:4)
+ *   datagram: cmd (1) idx (1) ADP (2) ADO (2) len:11 R:3 C:1 M:1 (2) IRQ (2) data WKC (2)
+ */
+
+#ifndef DATAGRAM_H
+#define DATAGRAM_H
+
+#include <stdint.h>
+
+#define DATAGRAM_ETH_HDR    14
+#define DATAGRAM_ECAT_HDR   2
+#define DATAGRAM_HDR        10
+#define DATAGRAM_WKC        2
+#define DATAGRAM_MAX_DATA   64
+
+// Datagram commands used here
+#define DATAGRAM_CMD_FPRD   4
+#define DATAGRAM_CMD_FPWR   5
+#define DATAGRAM_CMD_BWR    8
+#define DATAGRAM_CMD_LRD    10
+#define DATAGRAM_CMD_LWR    11
+#define DATAGRAM_CMD_LRW    12
+#define DATAGRAM_CMD_ARMW   13
+#define DATAGRAM_CMD_FRMW   14
+
+// Datagram length field: 11 bit length, M (more datagrams follow) in the top bit
+#define DATAGRAM_LEN_MASK       0x07FF
+#define DATAGRAM_MORE_FOLLOWS   0x8000
+
+typedef struct
+{
+    uint8_t  bytes[DATAGRAM_HDR + DATAGRAM_MAX_DATA + DATAGRAM_WKC];
+    int      length;            // Header + data + working counter
+} datagram;
+
+/**
+ * Precompute a datagram; returns 0 if `len` exceeds DATAGRAM_MAX_DATA
+ */
+int datagram_build(datagram *d, uint8_t cmd, uint16_t adp, uint16_t ado, const void *data, uint16_t len);
+
+/**
+ * Write a frame holding only `d`, with buffer index `idx`, after the
+ * Ethernet header of `frame`; returns the frame length
+ */
+int datagram_frame(uint8_t *frame, const datagram *d, uint8_t idx);
+
+/**
+ * Append `d` to the frame of `*frame_len` bytes (Ethernet header included)
+ * Walks the datagram chain, sets "more follows" on the last datagram,
+ * copies `d` behind it with the frame's index and grows the EtherCAT
+ * header length. Returns the offset of the appended datagram's data in
+ * `frame`, or 0 if the frame is malformed or would exceed `max_len`.
+ */
+int datagram_append(uint8_t *frame, int *frame_len, int max_len, const datagram *d);
+
+#endif
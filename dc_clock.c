@@ -0,0 +1,380 @@
+/**
+ * Distributed-clock time of the cyclic process data
+ * See dc_clock.h.
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include "ethercat.h"
+#include "dc_clock.h"
+#include "ec_link.h"
+
+// Drift compensation: ARMW per convergence check, frames in flight
+#define CONVERGE_BATCH      1000
+#define CONVERGE_FRAMES     8
+
+// Servo gains per sample; settles within a few thousand cycles
+#define SERVO_KP            0.02
+#define SERVO_KI            0.0002
+
+// Once settled, samples further than this off the model are rejected;
+// that many outliers in a row mean the clocks stepped, so lock again
+#define SERVO_SETTLE        1000
+#define SERVO_OUTLIER_NS    50000
+#define SERVO_RELOCK        100
+
+static int64_t sync_cycle_ns;
+static int64_t sync_shift_ns;
+static int     has_dc;
+static int64_t last_dc_ns;
+
+// Servo state, cyclic task only
+static dc_clock_sync_stats servo;
+static int64_t servo_ref_ns;        // Host time of the latest accepted sample
+static int64_t servo_base_ns;       // DC - host at lock; DC time since 2000 is too big for a double
+static double  servo_offset;        // DC - host - servo_base_ns at servo_ref_ns
+static double  servo_drift;         // d(DC - host) / d(host)
+static uint64_t servo_since_lock;   // Accepted samples since the (re)lock
+static int     servo_outlier_run;   // Consecutive rejected samples
+
+// Published model: DC = host + offset + drift * (host - ref)
+static _Atomic uint32_t model_seq;
+static struct
+{
+    int64_t ref_ns;
+    int64_t offset_ns;
+    double  drift;
+} model;
+
+// Steering
+static uint16 steer_adp;
+static int64_t steer_epoch_ns;      // DC - host when steering started
+static datagram steer_write;
+
+int dc_clock_init(uint32_t cycle_ns, int32_t shift_ns)
+{
+    sync_cycle_ns = cycle_ns;
+    sync_shift_ns = shift_ns;
+    has_dc = ec_group[0].hasdc ? 1 : 0;
+    last_dc_ns = 0;
+    return has_dc;
+}
+
+int64_t dc_clock_sync0_before(int64_t dc_ns)
+{
+    int64_t phase = (dc_ns - sync_shift_ns) % sync_cycle_ns;
+    if (phase < 0)
+        phase += sync_cycle_ns;
+    return dc_ns - phase;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int frame_max_len(void)
+{
+    return EC_MAXECATFRAME - 4;     // Without the FCS
+}
+
+/**
+ * Send `count` copies of `armw`, packed into full frames with up to
+ * CONVERGE_FRAMES on the wire at once
+ * Returns how many came back; a lost frame corrected no clock.
+ */
+static int armw_batch(const datagram *armw, int count)
+{
+    int idx[CONVERGE_FRAMES];
+    int carried[CONVERGE_FRAMES];
+    int sent = 0;
+    int returned = 0;
+
+    while (sent < count)
+    {
+        int frames = 0;
+        while (sent < count && frames < CONVERGE_FRAMES)
+        {
+            int i = ecx_getindex(&ecx_port);
+            int len = datagram_frame(ecx_port.txbuf[i], armw, (uint8)i);
+            int n = 1;
+            while (n < count - sent && datagram_append(ecx_port.txbuf[i], &len, frame_max_len(), armw))
+                n++;
+            ecx_port.txbuflength[i] = len;
+            ecx_outframe_red(&ecx_port, i);
+            idx[frames] = i;
+            carried[frames++] = n;
+            sent += n;
+        }
+
+        for (int f = 0; f < frames; f++)
+        {
+            if (ecx_waitinframe(&ecx_port, idx[f], EC_TIMEOUTRET) > EC_NOFRAME)
+                returned += carried[f];
+            ecx_setbufstat(&ecx_port, idx[f], EC_BUF_EMPTY);
+        }
+    }
+    return returned;
+}
+
+/**
+ * Largest |system time difference| over the DC slaves other than `ref`,
+ * read with one FPRD of 0x092C each, packed into as few frames as fit
+ * Returns -1 if a clock did not answer.
+ */
+static int64_t sysdiff_max(int ref, int *clocks)
+{
+    static const uint32 zero = 0;
+    int offset[EC_MAXSLAVE];
+    datagram rd;
+    int64_t max = 0;
+    int slave = 1;
+
+    *clocks = 0;
+    for (;;)
+    {
+        int idx = ecx_getindex(&ecx_port);
+        int len = 0;
+        int n = 0;
+
+        for (; slave <= ec_slavecount; slave++)
+        {
+            if (!ec_slave[slave].hasdc || slave == ref)
+                continue;
+            datagram_build(&rd, DATAGRAM_CMD_FPRD, ec_slave[slave].configadr, ECT_REG_DCSYSDIFF, &zero, sizeof(zero));
+            if (n == 0)
+            {
+                len = datagram_frame(ecx_port.txbuf[idx], &rd, (uint8)idx);
+                offset[n] = DATAGRAM_ETH_HDR + DATAGRAM_ECAT_HDR + DATAGRAM_HDR;
+            }
+            else if ((offset[n] = datagram_append(ecx_port.txbuf[idx], &len, frame_max_len(), &rd)) == 0)
+            {
+                break;
+            }
+            n++;
+        }
+        if (n == 0)
+        {
+            ecx_setbufstat(&ecx_port, idx, EC_BUF_EMPTY);
+            break;
+        }
+
+        ecx_port.txbuflength[idx] = len;
+        int wkc = ecx_srconfirm(&ecx_port, idx, EC_TIMEOUTRET);
+        for (int i = 0; i < n; i++)
+        {
+            // SOEM keeps the frame without its Ethernet header in rxbuf
+            const uint8 *p = ecx_port.rxbuf[idx] + offset[i] - DATAGRAM_ETH_HDR;
+            uint32 v = (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+
+            // Sign in bit 31 (set: local copy behind the received time), magnitude below
+            if (wkc <= 0 || p[4] == 0)
+                max = -1;
+            else if (max >= 0 && (int64_t)(v & 0x7FFFFFFF) > max)
+                max = v & 0x7FFFFFFF;
+        }
+        ecx_setbufstat(&ecx_port, idx, EC_BUF_EMPTY);
+        *clocks += n;
+    }
+    return max;
+}
+
+int dc_clock_converge(int max_datagrams, int64_t target_ns, dc_clock_converge_report *report)
+{
+    memset(report, 0, sizeof(*report));
+    if (!ec_group[0].hasdc)
+        return 0;
+
+    int ref = ec_group[0].DCnext;
+    int64_t start = now_ns();
+    int in_target = 0;
+    int sent = 0;
+    uint64 zero = 0;
+    datagram armw;
+
+    // ARMW by auto-increment position: the reference clock's time goes to every slave behind it
+    datagram_build(&armw, DATAGRAM_CMD_ARMW, (uint16)(1 - ref), ECT_REG_DCSYSTIME, &zero, sizeof(zero));
+
+    report->diff_max_ns = sysdiff_max(ref, &report->clocks);
+    while (report->clocks > 0 && sent < max_datagrams && in_target < 2)
+    {
+        int batch = max_datagrams - sent < CONVERGE_BATCH ? max_datagrams - sent : CONVERGE_BATCH;
+        sent += batch;
+        report->datagrams += armw_batch(&armw, batch);
+        report->diff_max_ns = sysdiff_max(ref, &report->clocks);
+        in_target = report->diff_max_ns >= 0 && report->diff_max_ns <= target_ns ? in_target + 1 : 0;
+    }
+
+    report->converged = report->clocks == 0 || in_target >= 2;
+    report->elapsed_ns = now_ns() - start;
+    return report->converged;
+}
+
+static void publish_model(void)
+{
+    atomic_store_explicit(&model_seq, atomic_load_explicit(&model_seq, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    model.ref_ns = servo_ref_ns;
+    model.offset_ns = servo_base_ns + (int64_t)servo_offset;
+    model.drift = servo_drift;
+    atomic_store_explicit(&model_seq, atomic_load_explicit(&model_seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+static void servo_sample(int64_t dc_ns, int64_t host_ns)
+{
+    if (!servo.locked)
+        servo_base_ns = dc_ns - host_ns;
+
+    double measured = (double)(dc_ns - host_ns - servo_base_ns);
+
+    if (!servo.locked)
+    {
+        servo_offset = measured;
+        servo_drift = 0;
+        servo_ref_ns = host_ns;
+        servo.locked = 1;
+    }
+    else
+    {
+        int64_t dt = host_ns - servo_ref_ns;
+        if (dt <= 0)
+            return;
+
+        double predicted = servo_offset + servo_drift * dt;
+        double err = measured - predicted;
+        int64_t abs_err = (int64_t)(err < 0 ? -err : err);
+
+        if (servo_since_lock > SERVO_SETTLE && abs_err > SERVO_OUTLIER_NS)
+        {
+            servo.outliers++;
+            if (++servo_outlier_run < SERVO_RELOCK)
+                return;
+
+            // Not a delayed send but a step of either clock: start over from here
+            servo.relocks++;
+            servo.locked = 0;
+            servo_outlier_run = 0;
+            servo_since_lock = 0;
+            servo_sample(dc_ns, host_ns);
+            return;
+        }
+
+        servo_outlier_run = 0;
+        servo_offset = predicted + SERVO_KP * err;
+        servo_drift += SERVO_KI * err / dt;
+        servo_ref_ns = host_ns;
+        servo.error_ns = (int64_t)err;
+        if (abs_err > servo.error_max_ns)
+            servo.error_max_ns = abs_err;
+    }
+
+    servo.samples++;
+    servo_since_lock++;
+    publish_model();
+}
+
+void dc_clock_stamp(dc_stamp *stamp)
+{
+    // SOEM only updates ec_DCtime when the frame holding the FRMW came back
+    int64_t dc = ec_DCtime;
+
+    stamp->valid = has_dc && dc != last_dc_ns;
+    stamp->frame_ns = stamp->valid ? dc : 0;
+    stamp->sample_ns = stamp->valid ? dc_clock_sync0_before(dc) : 0;
+    stamp->host_ns = stamp->valid ? ec_link_dc_frame_tx_ns() : 0;
+    last_dc_ns = dc;
+
+    if (stamp->valid)
+        servo_sample(stamp->frame_ns, stamp->host_ns);
+}
+
+static void read_model(int64_t *ref_ns, int64_t *offset_ns, double *drift)
+{
+    uint32_t s1;
+    do
+    {
+        while ((s1 = atomic_load_explicit(&model_seq, memory_order_acquire)) & 1)
+            ;
+        *ref_ns = model.ref_ns;
+        *offset_ns = model.offset_ns;
+        *drift = model.drift;
+        atomic_thread_fence(memory_order_acquire);
+    }
+    while (atomic_load_explicit(&model_seq, memory_order_relaxed) != s1);
+}
+
+int64_t dc_clock_from_host(int64_t host_ns)
+{
+    int64_t ref, offset;
+    double drift;
+
+    read_model(&ref, &offset, &drift);
+    if (ref == 0)
+        return 0;
+    return host_ns + offset + (int64_t)(drift * (double)(host_ns - ref));
+}
+
+int64_t dc_clock_to_host(int64_t dc_ns)
+{
+    int64_t ref, offset;
+    double drift;
+
+    read_model(&ref, &offset, &drift);
+    if (ref == 0)
+        return 0;
+
+    // Inverse of the model to first order in the drift
+    int64_t host = dc_ns - offset;
+    return host - (int64_t)(drift * (double)(host - ref));
+}
+
+int64_t dc_clock_to_clock(int64_t dc_ns, clockid_t clock)
+{
+    struct timespec mono, other;
+
+    int64_t host = dc_clock_to_host(dc_ns);
+    if (host == 0 || clock == CLOCK_MONOTONIC)
+        return host;
+
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(clock, &other);
+    return host + ((int64_t)other.tv_sec - mono.tv_sec) * 1000000000 + (other.tv_nsec - mono.tv_nsec);
+}
+
+int dc_clock_steer_enable(void)
+{
+    if (!has_dc)
+        return 0;
+
+    steer_adp = ec_slave[ec_group[0].DCnext].configadr;
+    servo.steering = 1;
+    steer_epoch_ns = 0;
+    return 1;
+}
+
+void dc_clock_steer(int64_t host_tx_ns)
+{
+    if (!servo.steering || !servo.locked)
+        return;
+
+    // Hold DC - host at what it was when steering began
+    if (steer_epoch_ns == 0)
+        steer_epoch_ns = servo_base_ns + (int64_t)servo_offset;
+
+    // The ESC compares the low 32 bits with its own system time
+    uint32 t = htoel((uint32)(host_tx_ns + steer_epoch_ns));
+    datagram_build(&steer_write, DATAGRAM_CMD_FPWR, steer_adp, ECT_REG_DCSYSTIME, &t, sizeof(t));
+    ec_link_piggyback(&steer_write);
+}
+
+void dc_clock_get_sync_stats(dc_clock_sync_stats *stats)
+{
+    *stats = servo;
+    stats->offset_ns = servo_base_ns + (int64_t)servo_offset;
+    stats->drift_ppm = servo_drift * 1e6;
+    servo.error_max_ns = 0;
+}
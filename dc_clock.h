@@ -0,0 +1,141 @@
+/**
+ * Distributed-clock time of the cyclic process data
+ *
+ * With distributed clocks configured, SOEM puts an FRMW of the reference
+ * clock's system time (0x0910) into the first frame of every process-data
+ * exchange: the reference clock's time is read as the frame passes it
+ * and written to every later DC slave, which keeps their clocks on the
+ * reference. On receive SOEM stores the value in ec_DCtime, so every
+ * cycle already carries a DC timestamp at no extra frame cost.
+ *
+ * Drives in DC mode latch their inputs on SYNC0. ecx_dcsync0() places the
+ * SYNC0 events at whole multiples of the cycle time plus the shift, so
+ * the latch time of an input snapshot is the last SYNC0 event before the
+ * frame passed the reference clock. It can be computed in O(1) from the
+ * frame's DC time.
+ *
+ * DC system time counts nanoseconds since 2000-01-01.
+ *
+ * Host clock <-> DC time: every stamp pairs the frame's DC time with the
+ * time the frame left the host (its send time, or its launch time with
+ * SO_TXTIME). The reference clock is normally the first DC slave, which
+ * the frame passes within microseconds of leaving, so the difference of
+ * the two is the DC-to-host offset plus a small constant. A PI servo
+ * (cyclic task, O(1)) tracks offset and drift and publishes them under a
+ * seqlock; dc_clock_to_host() / dc_clock_from_host() convert in O(1)
+ * from any thread. Samples far off the model (a delayed send) are
+ * rejected once the servo has settled.
+ *
+ * By default the host follows DC. With steering on, the reference clock
+ * follows the host instead: each cycle the host time of the frame,
+ * shifted by the offset at the moment steering started, is written to
+ * the reference clock's system time (FPWR 0x0910, carried in the
+ * process-data frame). The ESC treats such a write as a drift-control
+ * input and adjusts its clock speed, and SOEM's FRMW passes the
+ * reference time on to the other slaves. The servo then sees the drift
+ * go to zero.
+ *
+ * Startup: ec_configdc() sets offsets and propagation delays but leaves
+ * the clocks running at their own rates; the ESCs' drift control only
+ * catches up from the cyclic FRMW, over seconds, with SYNC0 wandering
+ * meanwhile. dc_clock_converge() runs the static drift compensation
+ * first: thousands of ARMW of the reference clock's system time, many per
+ * frame, several frames in flight, checking the system time difference
+ * (0x092C) of every clock between batches.
+ */
+
+#ifndef DC_CLOCK_H
+#define DC_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct
+{
+    int64_t frame_ns;       // DC time at which the frame passed the reference clock
+    int64_t sample_ns;      // SYNC0 event the inputs were latched on
+    int64_t host_ns;        // CLOCK_MONOTONIC at which the frame left the host
+    int     valid;          // The frame came back with a new DC time
+} dc_stamp;
+
+typedef struct
+{
+    int      locked;            // The model is usable
+    int      steering;          // Reference clock follows the host
+    uint64_t samples;
+    uint64_t outliers;          // Samples rejected as too far off the model
+    uint64_t relocks;           // Model restarted after a run of outliers (clock step)
+    int64_t  offset_ns;         // DC time - host time
+    double   drift_ppm;         // DC clock rate relative to the host clock
+    int64_t  error_ns;          // Servo error of the latest sample
+    int64_t  error_max_ns;      // Largest servo error since the last snapshot
+} dc_clock_sync_stats;
+
+typedef struct
+{
+    int     clocks;             // DC slaves behind the reference clock
+    int     datagrams;          // ARMW that came back
+    int     converged;          // Every clock within the target
+    int64_t diff_max_ns;        // Largest |0x092C| at the end, -1 if a clock did not answer
+    int64_t elapsed_ns;
+} dc_clock_converge_report;
+
+/**
+ * SYNC0 grid of the chain: cycle time and shift as given to ec_dcsync0()
+ * Returns 1 if the process data carries a DC time (a DC reference clock
+ * was found in group 0), 0 otherwise.
+ */
+int dc_clock_init(uint32_t cycle_ns, int32_t shift_ns);
+
+/**
+ * Static drift compensation, after ec_configdc() and before SYNC0 starts
+ * Sends up to `max_datagrams` ARMW and stops early once every clock has
+ * stayed within `target_ns` for two checks in a row; only then does it
+ * count as converged. Returns report->converged; 0 without a DC
+ * reference clock.
+ */
+int dc_clock_converge(int max_datagrams, int64_t target_ns, dc_clock_converge_report *report);
+
+/**
+ * Cyclic task, right after ec_receive_processdata(): DC time of that
+ * exchange; also feeds the host <-> DC servo
+ */
+void dc_clock_stamp(dc_stamp *stamp);
+
+/**
+ * SYNC0 event at or before DC time `dc_ns`
+ */
+int64_t dc_clock_sync0_before(int64_t dc_ns);
+
+/**
+ * DC time -> CLOCK_MONOTONIC and back, from any thread
+ * Return 0 until the servo has its first sample.
+ */
+int64_t dc_clock_to_host(int64_t dc_ns);
+int64_t dc_clock_from_host(int64_t host_ns);
+
+/**
+ * DC time -> `clock` (e.g. CLOCK_REALTIME to line up with other sensors),
+ * through CLOCK_MONOTONIC at the current offset between the two
+ */
+int64_t dc_clock_to_clock(int64_t dc_ns, clockid_t clock);
+
+/**
+ * Steer the reference clock from the host clock from now on
+ * Call before the cyclic task starts. Returns 0 without a DC reference.
+ */
+int dc_clock_steer_enable(void);
+
+/**
+ * Cyclic task, before sending the process data: queue this cycle's
+ * write of the reference clock; `host_tx_ns` is when the frame will
+ * leave (its launch time if known, else now)
+ */
+void dc_clock_steer(int64_t host_tx_ns);
+
+/**
+ * Servo snapshot, resetting the error maximum
+ */
+void dc_clock_get_sync_stats(dc_clock_sync_stats *stats);
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * Continuous DC synchronization monitoring
+ * See dc_monitor.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ethercat.h"
+#include "dc_monitor.h"
+#include "ec_link.h"
+
+// Readings in flight between the cyclic task and the statistics thread
+#define MONITOR_RING        256
+
+// Statistics thread polling interval
+#define MONITOR_PERIOD_US   10000
+
+typedef struct
+{
+    uint16  slave;
+    uint8   valid;              // Came back with a working counter of 1
+    int32_t diff_ns;
+} sysdiff_reading;
+
+static sysdiff_reading ring[MONITOR_RING];
+static _Atomic uint32_t ring_head;          // Written by the cyclic task
+static _Atomic uint32_t ring_tail;          // Written by the statistics thread
+static _Atomic uint64_t ring_dropped;
+
+// Cyclic task state
+static uint16 clocks[EC_MAXSLAVE];
+static int clock_count;
+static int next_clock;
+static int pending_slave;                   // Slave of the read in flight, 0 = none
+static int pending_slot;
+static datagram read_sysdiff;
+
+static pthread_t mon_thread;
+static atomic_int mon_running = 0;
+static int32_t threshold;
+
+// Statistics, statistics thread; snapshots under the lock
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static dc_monitor_slave_stats slave_stats[EC_MAXSLAVE];
+static dc_monitor_stats totals;
+
+void dc_monitor_queue(void)
+{
+    static const uint32 zero = 0;
+
+    if (!atomic_load_explicit(&mon_running, memory_order_relaxed) || pending_slave != 0)
+        return;
+
+    int slave = clocks[next_clock];
+    next_clock = (next_clock + 1) % clock_count;
+
+    datagram_build(&read_sysdiff, DATAGRAM_CMD_FPRD, ec_slave[slave].configadr, ECT_REG_DCSYSDIFF,
+                   &zero, sizeof(zero));
+    pending_slot = ec_link_piggyback(&read_sysdiff);
+    if (pending_slot >= 0)
+        pending_slave = slave;
+}
+
+void dc_monitor_collect(void)
+{
+    uint8 raw[4];
+
+    if (pending_slave == 0)
+        return;
+
+    uint32_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring_tail, memory_order_acquire) >= MONITOR_RING)
+    {
+        atomic_fetch_add_explicit(&ring_dropped, 1, memory_order_relaxed);
+        pending_slave = 0;
+        return;
+    }
+
+    sysdiff_reading *r = &ring[head % MONITOR_RING];
+    r->slave = (uint16)pending_slave;
+    r->valid = ec_link_piggyback_result(pending_slot, raw, sizeof(raw)) == 1;
+
+    // Sign in bit 31 (set: local copy behind the received time), magnitude below
+    uint32 v = (uint32)raw[0] | ((uint32)raw[1] << 8) | ((uint32)raw[2] << 16) | ((uint32)raw[3] << 24);
+    r->diff_ns = (v & 0x80000000) ? -(int32_t)(v & 0x7FFFFFFF) : (int32_t)(v & 0x7FFFFFFF);
+
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    pending_slave = 0;
+}
+
+static void account(const sysdiff_reading *r)
+{
+    dc_monitor_slave_stats *s = &slave_stats[r->slave];
+
+    if (!r->valid)
+    {
+        s->missed++;
+        return;
+    }
+
+    int32_t abs_diff = r->diff_ns < 0 ? -r->diff_ns : r->diff_ns;
+    s->samples++;
+    s->diff_ns = r->diff_ns;
+    s->diff_abs_sum_ns += abs_diff;
+    if (abs_diff > s->diff_max_ns)
+        s->diff_max_ns = abs_diff;
+    totals.samples++;
+    if (abs_diff > totals.worst_ns)
+    {
+        totals.worst_ns = abs_diff;
+        totals.worst_slave = r->slave;
+    }
+
+    // Hysteresis so a slave hovering at the threshold reports once
+    if (!s->over && abs_diff > threshold)
+    {
+        s->over = 1;
+        s->events++;
+        totals.events++;
+        totals.over++;
+        printf("⚠ DC sync: slave %d (%s) off by %d ns (threshold %d ns)\n",
+               r->slave, ec_slave[r->slave].name, r->diff_ns, threshold);
+    }
+    else if (s->over && abs_diff < threshold / 2)
+    {
+        s->over = 0;
+        totals.over--;
+        printf("✓ DC sync: slave %d (%s) back within %d ns\n", r->slave, ec_slave[r->slave].name, abs_diff);
+    }
+}
+
+static void drain_ring(void)
+{
+    uint32_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+    pthread_mutex_lock(&stats_lock);
+    for (; tail != head; tail++)
+        account(&ring[tail % MONITOR_RING]);
+    pthread_mutex_unlock(&stats_lock);
+    atomic_store_explicit(&ring_tail, tail, memory_order_release);
+}
+
+static void *mon_main(void *arg)
+{
+    struct timespec period = { 0, MONITOR_PERIOD_US * 1000L };
+    (void)arg;
+
+    while (atomic_load(&mon_running))
+    {
+        drain_ring();
+        nanosleep(&period, NULL);
+    }
+
+    // Readings collected since the last pass, up to the final cycle
+    drain_ring();
+    return NULL;
+}
+
+/**
+ * Every DC slave except the reference clock, which the others follow
+ */
+static void find_clocks(void)
+{
+    clock_count = 0;
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        if (ec_slave[slave].hasdc && slave != ec_group[0].DCnext)
+            clocks[clock_count++] = (uint16)slave;
+    }
+}
+
+int dc_monitor_start(int32_t threshold_ns)
+{
+    if (!ec_group[0].hasdc || ecx_port.redstate != ECT_RED_NONE)
+        return 0;
+
+    find_clocks();
+    if (clock_count == 0)
+        return 0;
+
+    threshold = threshold_ns;
+    next_clock = 0;
+    pending_slave = 0;
+    atomic_store(&ring_head, 0);
+    atomic_store(&ring_tail, 0);
+    atomic_store(&ring_dropped, 0);
+    memset(slave_stats, 0, sizeof(slave_stats));
+    memset(&totals, 0, sizeof(totals));
+    totals.clocks = clock_count;
+
+    atomic_store(&mon_running, 1);
+    if (pthread_create(&mon_thread, NULL, mon_main, NULL) != 0)
+    {
+        atomic_store(&mon_running, 0);
+        return 0;
+    }
+    return clock_count;
+}
+
+void dc_monitor_stop(void)
+{
+    if (!atomic_load(&mon_running))
+        return;
+
+    atomic_store(&mon_running, 0);
+    pthread_join(mon_thread, NULL);
+}
+
+void dc_monitor_rescan(void)
+{
+    if (!atomic_load_explicit(&mon_running, memory_order_relaxed))
+        return;
+
+    // Slaves are only ever added, so the list keeps at least one clock
+    find_clocks();
+    next_clock %= clock_count;
+
+    pthread_mutex_lock(&stats_lock);
+    totals.clocks = clock_count;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void dc_monitor_get_stats(dc_monitor_stats *stats)
+{
+    pthread_mutex_lock(&stats_lock);
+    *stats = totals;
+    totals.worst_slave = 0;
+    totals.worst_ns = 0;
+    pthread_mutex_unlock(&stats_lock);
+    stats->dropped = atomic_load(&ring_dropped);
+}
+
+int dc_monitor_get_slave_stats(int slave, dc_monitor_slave_stats *stats)
+{
+    if (slave < 1 || slave > ec_slavecount)
+        return 0;
+
+    pthread_mutex_lock(&stats_lock);
+    *stats = slave_stats[slave];
+    slave_stats[slave].diff_max_ns = 0;
+    pthread_mutex_unlock(&stats_lock);
+    return stats->samples > 0 || stats->missed > 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * Continuous DC synchronization monitoring in OP
+ *
+ * Every DC slave behind the reference clock keeps the difference between
+ * its own system time and the last time it received from the reference
+ * in register 0x092C (sign in bit 31, magnitude below). Once per cycle
+ * the cyclic task reads that register of one slave, round-robin, with an
+ * FPRD carried in the process-data frame (ec_link_piggyback()), so the
+ * chain is covered every N cycles for 16 bytes per frame and no extra
+ * frame. The readings go through a lock-free ring to a low-priority
+ * thread, which keeps per-slave statistics and prints an event when a
+ * slave's difference exceeds the threshold, and again when it is back
+ * under half of it.
+ *
+ * Needs the DC frame that SOEM builds for the process data; not available
+ * in redundant mode.
+ */
+
+#ifndef DC_MONITOR_H
+#define DC_MONITOR_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t samples;           // Readings that came back
+    uint64_t missed;            // Readings lost with their frame
+    int32_t  diff_ns;           // Latest system time difference
+    int32_t  diff_max_ns;       // Largest |difference| since the last snapshot
+    int64_t  diff_abs_sum_ns;   // Sum of |difference|, for the mean
+    uint32_t events;            // Threshold crossings
+    int      over;              // Currently above the threshold
+} dc_monitor_slave_stats;
+
+typedef struct
+{
+    int      clocks;            // Slaves monitored
+    uint64_t samples;
+    uint64_t dropped;           // Readings lost because the ring was full
+    uint32_t events;
+    int      over;              // Slaves currently above the threshold
+    int      worst_slave;       // Largest |difference| since the last snapshot, 0 = none
+    int32_t  worst_ns;
+} dc_monitor_stats;
+
+/**
+ * Start the statistics thread; `threshold_ns` is the event threshold
+ * Returns the number of monitored slaves, 0 if there are none or the
+ * monitor cannot run (no DC, redundant mode, thread not started).
+ */
+int dc_monitor_start(int32_t threshold_ns);
+
+/**
+ * Stop the cyclic reads and the statistics thread, which accounts every
+ * reading collected so far before it exits
+ * Call after the last dc_monitor_collect().
+ */
+void dc_monitor_stop(void);
+
+/**
+ * Cyclic task, before sending the process data: queue the read of the
+ * next slave unless the previous one has not been collected yet
+ */
+void dc_monitor_queue(void);
+
+/**
+ * Cyclic task, right after ec_receive_processdata(): hand the reading
+ * over to the statistics thread (a few stores)
+ */
+void dc_monitor_collect(void);
+
+/**
+ * Cyclic task, after a topology change: pick up the DC clocks of slaves
+ * added since dc_monitor_start()
+ */
+void dc_monitor_rescan(void);
+
+/**
+ * Snapshot of the totals / of one slave, resetting the maxima
+ * dc_monitor_get_slave_stats() returns 0 if `slave` has no readings.
+ */
+void dc_monitor_get_stats(dc_monitor_stats *stats);
+int dc_monitor_get_slave_stats(int slave, dc_monitor_slave_stats *stats);
+
+#endif
@@ -0,0 +1,928 @@
+/**
+ * Link-layer backend selection for SOEM
+ * See ec_link.h for how the wrappers are hooked in.
+ *
+ * The AF_XDP receive path, also used for the raw socket when receive
+ * timestamps are wanted, mirrors SOEM's ecx_inframe(): a frame for the
+ * requested buffer index completes that index, a frame for another index
+ * that is still in flight is parked in its rx buffer as EC_BUF_RCVD, and
+ * anything else is dropped. Buffer bookkeeping (rxbufstat, rxsa) stays in
+ * SOEM's port structure, so the rest of the library is unaware of the swap.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/sockios.h>
+#include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "ethercat.h"
+#include "ec_link.h"
+#include "xdp_socket.h"
+
+enum
+{
+    LINK_RAW = 0,
+    LINK_XDP
+};
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+
+// Bounced frames in a row before the ring counts as broken
+#define RED_BREAK_FRAMES 3
+
+// Earliest launch of a frame, relative to the send call; below this ETF may drop it
+#define LAUNCH_LEAD_NS 10000
+
+static int link_backend = LINK_RAW;
+static int link_busy_poll = 0;
+static xdp_socket link_xsk;
+
+// Redundancy bookkeeping, updated only for process-data (logical) frames,
+// which only the cyclic task sends
+static ec_link_red_stats red_stats;
+static int64_t red_intact_sum_ns;
+static int64_t red_broken_sum_ns;
+static int red_bounced_run;        // Consecutive frames bounced back on their own port
+
+// Per-index send / first-seen times of frames on the primary port
+static int64_t frame_tx_ns[EC_MAXBUF];
+static int64_t frame_rx_ns[EC_MAXBUF];
+static int64_t last_tx_ns;
+
+// Send-side / receive-side socket timestamps per index, [0] software, [1] hardware
+static int link_timestamping = EC_LINK_TS_OFF;
+static struct ifreq hwtstamp_ifr;           // Interface whose NIC config we changed
+static struct hwtstamp_config hwtstamp_saved;
+static int hwtstamp_changed;
+static int64_t frame_tx_stamp[EC_MAXBUF][2];
+
+// SOF_TIMESTAMPING_OPT_ID numbers the frames sent on the socket, and with
+// OPT_TSONLY a transmit stamp carries that number instead of the frame;
+// tx_key_lock keeps our count in the kernel's order
+#define TX_KEY_RING 64
+static pthread_mutex_t tx_key_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t tx_key;
+static struct
+{
+    uint32_t key;
+    int      idx;
+} tx_key_idx[TX_KEY_RING];
+static int64_t frame_rx_stamp[EC_MAXBUF][2];
+
+// Datagrams to append to the next process-data frame carrying the DC time,
+// and where the last batch went; cyclic thread only
+static datagram piggyback_queue[EC_LINK_PIGGYBACK_MAX];
+static int piggyback_queued;
+static int piggyback_sent;
+static int piggyback_idx;
+static int piggyback_offset[EC_LINK_PIGGYBACK_MAX];
+static int piggyback_len[EC_LINK_PIGGYBACK_MAX];
+static int64_t dc_frame_tx_ns;
+
+// Launch-time scheduling; launch_last_tai_ns is guarded by tx_mutex, the
+// counters are only touched by the cyclic thread (armed frames, error queue)
+static ec_link_launch_stats launch_stats;
+static __thread int64_t launch_ns;
+static int64_t launch_last_tai_ns;
+
+// SOEM originals, resolved by the linker through --wrap
+int __real_ecx_outframe_red(ecx_portt *port, int idx);
+int __real_ecx_waitinframe(ecx_portt *port, int idx, int timeout);
+int __real_ecx_srconfirm(ecx_portt *port, int idx, int timeout);
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Stamp every frame that has come back but not been stamped yet
+ * Frames parked for another index while SOEM waited are seen here, at the
+ * end of that wait, so their time is an upper bound.
+ */
+static void stamp_received(ecx_portt *port, int64_t t)
+{
+    for (int idx = 0; idx < EC_MAXBUF; idx++)
+    {
+        if (frame_rx_ns[idx] == 0 &&
+            (port->rxbufstat[idx] == EC_BUF_RCVD || port->rxbufstat[idx] == EC_BUF_COMPLETE))
+            frame_rx_ns[idx] = t;
+    }
+}
+
+int64_t ec_link_frame_rtt_ns(int idx)
+{
+    if (idx < 0 || idx >= EC_MAXBUF || frame_rx_ns[idx] == 0)
+        return -1;
+    return frame_rx_ns[idx] - frame_tx_ns[idx];
+}
+
+int64_t ec_link_last_tx_ns(void)
+{
+    return last_tx_ns;
+}
+
+int ec_link_send_datagram(const datagram *d)
+{
+    int idx = ecx_getindex(&ecx_port);
+
+    ecx_port.txbuflength[idx] = datagram_frame(ecx_port.txbuf[idx], d, (uint8)idx);
+    ecx_outframe_red(&ecx_port, idx);
+    return idx;
+}
+
+int ec_link_collect_datagram(int idx, int timeout_us)
+{
+    int wkc = ecx_waitinframe(&ecx_port, idx, timeout_us);
+    ecx_setbufstat(&ecx_port, idx, EC_BUF_EMPTY);
+    return wkc;
+}
+
+/**
+ * Does the frame in `idx` start with a logical read/write, i.e. is it
+ * process data rather than mailbox, state or DC traffic?
+ */
+static int process_data_frame(ecx_portt *port, int idx)
+{
+    int cmd = port->txbuf[idx][ETH_HEADERSIZE + DATAGRAM_ECAT_HDR];
+    return cmd == DATAGRAM_CMD_LRD || cmd == DATAGRAM_CMD_LWR || cmd == DATAGRAM_CMD_LRW;
+}
+
+/**
+ * Is the frame in `idx` the first frame of a process-data exchange with
+ * DC: a logical read/write followed by SOEM's FRMW of the system time?
+ * SOEM reads that frame's working counter and DC time at fixed offsets,
+ * so datagrams appended behind them go unnoticed. For every other frame
+ * it takes the working counter of the last datagram.
+ */
+static int carries_dc_time(ecx_portt *port, int idx)
+{
+    const uint8 *d = port->txbuf[idx] + ETH_HEADERSIZE + DATAGRAM_ECAT_HDR;
+    uint16 len = d[6] | (d[7] << 8);
+
+    if (!process_data_frame(port, idx))
+        return 0;
+    if (!(len & DATAGRAM_MORE_FOLLOWS))
+        return 0;
+
+    int next = ETH_HEADERSIZE + DATAGRAM_ECAT_HDR + DATAGRAM_HDR + (len & DATAGRAM_LEN_MASK) + DATAGRAM_WKC;
+    return next < port->txbuflength[idx] && port->txbuf[idx][next] == DATAGRAM_CMD_FRMW;
+}
+
+static void piggyback_attach(ecx_portt *port, int idx)
+{
+    int max_len = EC_MAXECATFRAME - 4;      // Without the FCS
+
+    piggyback_sent = 0;
+    piggyback_idx = idx;
+    if (port->redstate == ECT_RED_NONE)
+    {
+        for (int i = 0; i < piggyback_queued; i++)
+        {
+            int off = datagram_append(port->txbuf[idx], &port->txbuflength[idx], max_len, &piggyback_queue[i]);
+            if (off == 0)
+                break;
+            piggyback_offset[i] = off;
+            piggyback_len[i] = piggyback_queue[i].length - DATAGRAM_HDR - DATAGRAM_WKC;
+            piggyback_sent++;
+        }
+    }
+    piggyback_queued = 0;
+}
+
+int ec_link_piggyback(const datagram *d)
+{
+    if (piggyback_queued >= EC_LINK_PIGGYBACK_MAX)
+        return -1;
+    piggyback_queue[piggyback_queued] = *d;
+    return piggyback_queued++;
+}
+
+int ec_link_piggyback_result(int slot, void *data, int len)
+{
+    if (slot < 0 || slot >= piggyback_sent || frame_rx_ns[piggyback_idx] == 0)
+        return -1;
+
+    // SOEM keeps the frame without its Ethernet header in rxbuf
+    const uint8 *p = ecx_port.rxbuf[piggyback_idx] + piggyback_offset[slot] - ETH_HEADERSIZE;
+    int dlen = piggyback_len[slot];
+    if (data != NULL)
+        memcpy(data, p, len < dlen ? len : dlen);
+    return p[dlen] | (p[dlen + 1] << 8);
+}
+
+int64_t ec_link_dc_frame_tx_ns(void)
+{
+    return dc_frame_tx_ns;
+}
+
+int ec_link_open_xdp(const char *ifname, int queue, int force_copy)
+{
+    if (ecx_port.redstate != ECT_RED_NONE)
+    {
+        printf("AF_XDP backend does not support redundant mode\n");
+        return 0;
+    }
+
+    if (xdp_socket_open(&link_xsk, ifname, queue, force_copy ? XDP_SOCKET_FORCE_COPY : 0))
+        return 0;
+
+    link_backend = LINK_XDP;
+    return 1;
+}
+
+void ec_link_close(void)
+{
+    // The NIC-wide timestamping config may belong to a PTP daemon as well
+    if (hwtstamp_changed)
+    {
+        hwtstamp_ifr.ifr_data = (char *)&hwtstamp_saved;
+        if (ioctl(ecx_port.sockhandle, SIOCSHWTSTAMP, &hwtstamp_ifr) < 0)
+            printf("Timestamping: cannot restore the NIC config of %s: %s\n", hwtstamp_ifr.ifr_name,
+                   strerror(errno));
+        hwtstamp_changed = 0;
+    }
+
+    if (link_backend == LINK_XDP)
+    {
+        link_backend = LINK_RAW;
+        xdp_socket_close(&link_xsk);
+    }
+}
+
+/**
+ * Is there an ETF qdisc anywhere on `ifname`? Without one the kernel sends
+ * SO_TXTIME frames at once and ignores their launch time.
+ * Returns 1 / 0, -1 if the qdiscs cannot be listed.
+ */
+static int etf_installed(const char *ifname)
+{
+    int ifindex = if_nametoindex(ifname);
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (ifindex == 0 || fd < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    struct
+    {
+        struct nlmsghdr nh;
+        struct tcmsg    tc;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = sizeof(req);
+    req.nh.nlmsg_type = RTM_GETQDISC;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.tc.tcm_family = AF_UNSPEC;
+    req.tc.tcm_ifindex = ifindex;
+    if (send(fd, &req, sizeof(req), 0) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    static char buf[16384];
+    int found = 0;
+    for (;;)
+    {
+        int len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0)
+        {
+            close(fd);
+            return found ? 1 : -1;
+        }
+        for (struct nlmsghdr *nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len))
+        {
+            if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR)
+            {
+                close(fd);
+                return nh->nlmsg_type == NLMSG_DONE || found ? found : -1;
+            }
+            if (nh->nlmsg_type != RTM_NEWQDISC)
+                continue;
+
+            // The dump lists every interface's qdiscs; keep this one's
+            struct tcmsg *tc = NLMSG_DATA(nh);
+            if (tc->tcm_ifindex != ifindex)
+                continue;
+            int alen = nh->nlmsg_len - NLMSG_LENGTH(sizeof(*tc));
+            for (struct rtattr *a = (struct rtattr *)((char *)tc + NLMSG_ALIGN(sizeof(*tc))); RTA_OK(a, alen);
+                 a = RTA_NEXT(a, alen))
+            {
+                if (a->rta_type == TCA_KIND && strcmp(RTA_DATA(a), "etf") == 0)
+                    found = 1;
+            }
+        }
+    }
+}
+
+int ec_link_enable_launch_time(const char *ifname)
+{
+    if (link_backend == LINK_XDP || ecx_port.redstate != ECT_RED_NONE)
+    {
+        printf("Launch time: only available on the raw socket without redundancy\n");
+        return EC_LINK_LAUNCH_OFF;
+    }
+
+    // ETF compares against CLOCK_TAI; report missed / invalid launch times
+    struct sock_txtime txtime = { .clockid = CLOCK_TAI, .flags = SOF_TXTIME_REPORT_ERRORS };
+    int etf = etf_installed(ifname);
+    if (etf == 0)
+    {
+        printf("Launch time: no ETF qdisc on %s, the kernel would ignore launch times "
+               "(see scripts/etf_setup.sh); spinning until launch instead\n", ifname);
+        launch_stats.mode = EC_LINK_LAUNCH_SPIN;
+    }
+    else if (setsockopt(ecx_port.sockhandle, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) == 0)
+    {
+        if (etf < 0)
+            printf("Launch time: cannot list the qdiscs of %s; launch times only hold with ETF installed\n",
+                   ifname);
+        launch_stats.mode = EC_LINK_LAUNCH_TXTIME;
+
+        int prio = EC_LINK_LAUNCH_PRIORITY;
+        if (setsockopt(ecx_port.sockhandle, SOL_SOCKET, SO_PRIORITY, &prio, sizeof(prio)) < 0)
+            printf("Launch time: cannot set socket priority %d: %s\n", prio, strerror(errno));
+    }
+    else
+    {
+        printf("Launch time: SO_TXTIME not available (%s), spinning until launch instead\n", strerror(errno));
+        launch_stats.mode = EC_LINK_LAUNCH_SPIN;
+    }
+    launch_stats.lead_min_ns = INT64_MAX;
+    return launch_stats.mode;
+}
+
+static int64_t timespec_ns(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/**
+ * Store the software / hardware stamps of an SCM_TIMESTAMPING message
+ */
+static void take_stamps(const struct cmsghdr *c, int64_t stamp[2])
+{
+    struct scm_timestamping tss;
+
+    memcpy(&tss, CMSG_DATA(c), sizeof(tss));
+    if (tss.ts[0].tv_sec != 0 || tss.ts[0].tv_nsec != 0)
+        stamp[0] = timespec_ns(&tss.ts[0]);
+    if (tss.ts[2].tv_sec != 0 || tss.ts[2].tv_nsec != 0)
+        stamp[1] = timespec_ns(&tss.ts[2]);
+}
+
+/**
+ * Read the socket's error queue: transmit timestamps, each carrying the
+ * OPT_ID number of its frame, and launch-time errors reported by the ETF
+ * qdisc
+ */
+static void drain_errqueue(void)
+{
+    uint8 data[ETH_HEADERSIZE + EC_HEADERSIZE];
+    char control[256];
+
+    for (;;)
+    {
+        struct iovec iov = { data, sizeof(data) };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control,
+                              .msg_controllen = sizeof(control) };
+        int len = recvmsg(ecx_port.sockhandle, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if (len < 0)
+            break;
+
+        const struct cmsghdr *stamp = NULL;
+        int tx_stamp = 0;
+        uint32_t key = 0;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c))
+        {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING)
+            {
+                stamp = c;
+            }
+            else if (c->cmsg_level == SOL_PACKET && c->cmsg_type == PACKET_TX_TIMESTAMP)
+            {
+                struct sock_extended_err *ee = (struct sock_extended_err *)CMSG_DATA(c);
+                if (ee->ee_origin == SO_EE_ORIGIN_TXTIME)
+                    launch_stats.dropped++;
+                else if (ee->ee_origin == SO_EE_ORIGIN_TIMESTAMPING && ee->ee_info == SCM_TSTAMP_SND)
+                {
+                    tx_stamp = 1;
+                    key = ee->ee_data;
+                }
+            }
+        }
+
+        // A stamp older than the ring no longer identifies its frame
+        if (tx_stamp && stamp != NULL && tx_key_idx[key % TX_KEY_RING].key == key)
+            take_stamps(stamp, frame_tx_stamp[tx_key_idx[key % TX_KEY_RING].idx]);
+    }
+}
+
+void ec_link_set_launch(int64_t t)
+{
+    launch_ns = t;
+
+    // Once per cycle: every qdisc drop queues a clone of its frame on the error
+    // queue, charged to the receive buffer that EtherCAT replies also need
+    if (t != 0 && launch_stats.mode == EC_LINK_LAUNCH_TXTIME)
+        drain_errqueue();
+}
+
+void ec_link_get_launch_stats(ec_link_launch_stats *stats)
+{
+    if (launch_stats.mode == EC_LINK_LAUNCH_TXTIME)
+        drain_errqueue();
+    *stats = launch_stats;
+    if (stats->frames == 0)
+        stats->lead_min_ns = 0;
+}
+
+int ec_link_enable_timestamping(const char *ifname)
+{
+    if (link_backend == LINK_XDP || ecx_port.redstate != ECT_RED_NONE)
+    {
+        printf("Timestamping: only available on the raw socket without redundancy\n");
+        return EC_LINK_TS_OFF;
+    }
+
+    // Hardware stamps need the NIC to stamp every frame, not only PTP. The
+    // setting is NIC-wide, so keep the current one for ec_link_close().
+    struct hwtstamp_config hw = { .tx_type = HWTSTAMP_TX_ON, .rx_filter = HWTSTAMP_FILTER_ALL };
+    memset(&hwtstamp_ifr, 0, sizeof(hwtstamp_ifr));
+    snprintf(hwtstamp_ifr.ifr_name, sizeof(hwtstamp_ifr.ifr_name), "%s", ifname);
+    hwtstamp_ifr.ifr_data = (char *)&hwtstamp_saved;
+    int saved = ioctl(ecx_port.sockhandle, SIOCGHWTSTAMP, &hwtstamp_ifr) == 0;
+
+    struct ifreq ifr = hwtstamp_ifr;
+    ifr.ifr_data = (char *)&hw;
+    int hardware = 0;
+    if (saved && hwtstamp_saved.rx_filter == HWTSTAMP_FILTER_ALL && hwtstamp_saved.tx_type == HWTSTAMP_TX_ON)
+    {
+        hardware = 1;
+    }
+    else if (saved && ioctl(ecx_port.sockhandle, SIOCSHWTSTAMP, &ifr) == 0)
+    {
+        hwtstamp_changed = 1;
+        hardware = hw.rx_filter == HWTSTAMP_FILTER_ALL;
+    }
+
+    // Software stamps as well: they cover frames the NIC leaves unstamped.
+    // Transmit stamps come back without a copy of the frame (OPT_TSONLY),
+    // numbered by OPT_ID, so they cost the socket receive buffer little.
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_TSONLY | SOF_TIMESTAMPING_OPT_ID;
+    if (hardware)
+        flags |= SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(ecx_port.sockhandle, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+    {
+        printf("Timestamping: SO_TIMESTAMPING failed: %s\n", strerror(errno));
+        return EC_LINK_TS_OFF;
+    }
+
+    // OPT_ID restarts the kernel's count at 0
+    tx_key = 0;
+    for (int i = 0; i < TX_KEY_RING; i++)
+        tx_key_idx[i].key = UINT32_MAX;
+    link_timestamping = hardware ? EC_LINK_TS_HARDWARE : EC_LINK_TS_SOFTWARE;
+    return link_timestamping;
+}
+
+int ec_link_timestamping(void)
+{
+    return link_timestamping;
+}
+
+int64_t ec_link_frame_wire_rtt_ns(int idx)
+{
+    if (idx < 0 || idx >= EC_MAXBUF || link_timestamping == EC_LINK_TS_OFF)
+        return -1;
+
+    // Transmit stamps trail the send; collect whatever has arrived
+    drain_errqueue();
+
+    // Both stamps from the same clock: hardware if the NIC stamped both ways
+    for (int hw = 1; hw >= 0; hw--)
+    {
+        if (frame_tx_stamp[idx][hw] != 0 && frame_rx_stamp[idx][hw] != 0)
+            return frame_rx_stamp[idx][hw] - frame_tx_stamp[idx][hw];
+    }
+    return -1;
+}
+
+static int set_socket_busy_poll(int sock, int busy_poll_us)
+{
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        printf("Busy-poll: cannot make socket non-blocking: %s\n", strerror(errno));
+        return 0;
+    }
+
+    // Best effort: needs CAP_NET_ADMIN and a NAPI-capable driver to have any effect
+    int opt = busy_poll_us;
+    if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &opt, sizeof(opt)) < 0)
+        printf("Busy-poll: SO_BUSY_POLL not available (%s), spinning on recv only\n", strerror(errno));
+    opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt));
+
+    return 1;
+}
+
+int ec_link_set_busy_poll(int busy_poll_us)
+{
+    if (link_backend == LINK_XDP)
+    {
+        link_busy_poll = 1;
+        return 1;
+    }
+
+    if (!set_socket_busy_poll(ecx_port.sockhandle, busy_poll_us))
+        return 0;
+    if (ecx_port.redstate != ECT_RED_NONE && ecx_port.redport != NULL &&
+        !set_socket_busy_poll(ecx_port.redport->sockhandle, busy_poll_us))
+        return 0;
+
+    link_busy_poll = 1;
+    return 1;
+}
+
+int ec_link_line_break(void)
+{
+    return red_stats.line_break;
+}
+
+void ec_link_get_red_stats(ec_link_red_stats *stats)
+{
+    *stats = red_stats;
+
+    uint64_t intact = red_stats.frames - red_stats.broken_frames - red_stats.lost_frames;
+    stats->intact_rx_ns = intact ? red_intact_sum_ns / (int64_t)intact : 0;
+    stats->broken_rx_ns = red_stats.broken_frames ? red_broken_sum_ns / (int64_t)red_stats.broken_frames : 0;
+}
+
+/**
+ * Classify a cyclic frame that just completed in redundant mode
+ * SOEM leaves both ports' rx buffers marked complete and the source MAC
+ * word of what each port received in rxsa until the caller releases the
+ * index, which is what its own resend logic decides on as well.
+ */
+static void red_account(ecx_portt *port, int idx, int64_t rx_ns)
+{
+    int primrx = port->rxbufstat[idx] == EC_BUF_COMPLETE ? port->rxsa[idx] : 0;
+    int secrx = port->redport->rxbufstat[idx] == EC_BUF_COMPLETE ? port->redport->rxsa[idx] : 0;
+
+    red_stats.frames++;
+    if (primrx == RX_SEC && secrx == RX_PRIM)
+    {
+        red_intact_sum_ns += rx_ns;
+        red_bounced_run = 0;
+        red_stats.line_break = 0;
+    }
+    else if (primrx == RX_PRIM || secrx == RX_SEC)
+    {
+        // A frame back on the port it left from turned at a break
+        red_stats.broken_frames++;
+        red_broken_sum_ns += rx_ns;
+        if (rx_ns > red_stats.broken_rx_max_ns)
+            red_stats.broken_rx_max_ns = rx_ns;
+        if (++red_bounced_run >= RED_BREAK_FRAMES && !red_stats.line_break)
+        {
+            red_stats.breaks++;
+            red_stats.line_break = 1;
+        }
+    }
+    else
+    {
+        // Missing on a port with no sign of a break: leaves the ring state alone
+        red_stats.lost_frames++;
+    }
+}
+
+const char *ec_link_name(void)
+{
+    if (link_backend == LINK_RAW && ecx_port.redstate != ECT_RED_NONE)
+        return link_busy_poll ? "raw socket, redundant (busy-poll)" : "raw socket, redundant";
+    if (link_backend == LINK_XDP)
+    {
+        if (link_xsk.zerocopy)
+            return "AF_XDP (zero-copy)";
+        return link_xsk.driver_mode ? "AF_XDP (copy, native)" : "AF_XDP (copy, generic)";
+    }
+    return link_busy_poll ? "raw socket (busy-poll)" : "raw socket";
+}
+
+static int xdp_outframe(ecx_portt *port, int idx)
+{
+    ec_etherheadert *ehp = (ec_etherheadert *)&port->txbuf[idx];
+    int rval;
+
+    // Same source MAC tagging as SOEM uses for the primary port
+    ehp->sa1 = htons(priMAC[1]);
+
+    pthread_mutex_lock(&port->tx_mutex);
+    port->rxbufstat[idx] = EC_BUF_TX;
+    rval = xdp_socket_send(&link_xsk, port->txbuf[idx], port->txbuflength[idx]);
+    if (rval < 0)
+        port->rxbufstat[idx] = EC_BUF_EMPTY;
+    pthread_mutex_unlock(&port->tx_mutex);
+
+    return rval;
+}
+
+/**
+ * SOEM's primary-port send, through sendmsg() with an SCM_TXTIME launch time
+ * Returns the send result; `*tx_ns` receives the launch time
+ * (CLOCK_MONOTONIC).
+ */
+static int txtime_outframe(ecx_portt *port, int idx, int64_t *tx_ns)
+{
+    ec_etherheadert *ehp = (ec_etherheadert *)&port->txbuf[idx];
+    struct timespec tai;
+    int rval;
+
+    ehp->sa1 = htons(priMAC[1]);
+
+    pthread_mutex_lock(&port->tx_mutex);
+
+    // Grid times are CLOCK_MONOTONIC; ETF wants CLOCK_TAI
+    int64_t mono = now_ns();
+    clock_gettime(CLOCK_TAI, &tai);
+    int64_t tai_offset = (int64_t)tai.tv_sec * 1000000000 + tai.tv_nsec - mono;
+
+    int64_t launch = mono + LAUNCH_LEAD_NS;
+    if (launch_ns != 0)
+    {
+        launch_stats.frames++;
+        if (launch_ns - mono < launch_stats.lead_min_ns)
+            launch_stats.lead_min_ns = launch_ns - mono;
+        if (launch_ns >= launch)
+            launch = launch_ns;
+        else
+            launch_stats.late++;
+    }
+    uint64_t txtime = (uint64_t)(launch + tai_offset);
+    if ((int64_t)txtime < launch_last_tai_ns)
+        txtime = (uint64_t)launch_last_tai_ns;
+    launch_last_tai_ns = (int64_t)txtime;
+    *tx_ns = (int64_t)txtime - tai_offset;
+
+    char control[CMSG_SPACE(sizeof(txtime))] = { 0 };
+    struct iovec iov = { port->txbuf[idx], (size_t)port->txbuflength[idx] };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control,
+                          .msg_controllen = sizeof(control) };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_TXTIME;
+    c->cmsg_len = CMSG_LEN(sizeof(txtime));
+    memcpy(CMSG_DATA(c), &txtime, sizeof(txtime));
+
+    port->rxbufstat[idx] = EC_BUF_TX;
+    rval = sendmsg(port->sockhandle, &msg, 0);
+    if (rval < 0)
+        port->rxbufstat[idx] = EC_BUF_EMPTY;
+    pthread_mutex_unlock(&port->tx_mutex);
+
+    return rval;
+}
+
+/**
+ * Software launch: hold the calling thread until its armed launch time
+ */
+static void spin_until_launch(void)
+{
+    int64_t t = now_ns();
+
+    launch_stats.frames++;
+    if (launch_ns - t < launch_stats.lead_min_ns)
+        launch_stats.lead_min_ns = launch_ns - t;
+    if (t > launch_ns)
+        launch_stats.late++;
+    while (t < launch_ns)
+        t = now_ns();
+}
+
+/**
+ * Raw-socket receive with the frame's receive stamps (timestamping on)
+ */
+static int raw_recv(ecx_portt *port, int64_t stamp[2])
+{
+    char control[256];
+    struct iovec iov = { port->tempinbuf, sizeof(port->tempinbuf) };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control,
+                          .msg_controllen = sizeof(control) };
+
+    int len = recvmsg(port->sockhandle, &msg, 0);
+    if (len <= 0)
+        return len;
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c))
+    {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING)
+            take_stamps(c, stamp);
+    }
+    return len;
+}
+
+/**
+ * ecx_inframe() for the frames this module receives itself: AF_XDP, or
+ * the raw socket when its receive stamps are wanted
+ */
+static int link_inframe(ecx_portt *port, int idx)
+{
+    uint8 *rxbuf = port->rxbuf[idx];
+    int rval = EC_NOFRAME;
+    int64_t stamp[2] = { 0, 0 };
+
+    // Frame may already have arrived while another index was being polled
+    if (port->rxbufstat[idx] == EC_BUF_RCVD)
+    {
+        int l = rxbuf[0] + ((uint16)(rxbuf[1] & 0x0f) << 8);
+        rval = rxbuf[l] + ((uint16)rxbuf[l + 1] << 8);
+        port->rxbufstat[idx] = EC_BUF_COMPLETE;
+        return rval;
+    }
+
+    pthread_mutex_lock(&port->rx_mutex);
+
+    int len;
+    if (link_backend == LINK_XDP)
+        len = xdp_socket_recv(&link_xsk, port->tempinbuf, sizeof(port->tempinbuf));
+    else
+        len = raw_recv(port, stamp);
+    if (len >= (int)(ETH_HEADERSIZE + EC_HEADERSIZE))
+    {
+        ec_etherheadert *ehp = (ec_etherheadert *)port->tempinbuf;
+        rval = EC_OTHERFRAME;
+
+        if (ehp->etype == htons(ETH_P_ECAT))
+        {
+            ec_comt *ecp = (ec_comt *)&port->tempinbuf[ETH_HEADERSIZE];
+            int l = etohs(ecp->elength) & 0x0fff;
+            int idxf = ecp->index;
+
+            if (idxf == idx)
+            {
+                memcpy(rxbuf, &port->tempinbuf[ETH_HEADERSIZE], port->txbuflength[idx] - ETH_HEADERSIZE);
+                rval = rxbuf[l] + ((uint16)rxbuf[l + 1] << 8);
+                port->rxbufstat[idx] = EC_BUF_COMPLETE;
+                port->rxsa[idx] = ntohs(ehp->sa1);
+                memcpy(frame_rx_stamp[idx], stamp, sizeof(stamp));
+            }
+            else if (idxf < EC_MAXBUF && port->rxbufstat[idxf] == EC_BUF_TX)
+            {
+                frame_rx_ns[idxf] = now_ns();
+                memcpy(port->rxbuf[idxf], &port->tempinbuf[ETH_HEADERSIZE], port->txbuflength[idxf] - ETH_HEADERSIZE);
+                port->rxbufstat[idxf] = EC_BUF_RCVD;
+                port->rxsa[idxf] = ntohs(ehp->sa1);
+                memcpy(frame_rx_stamp[idxf], stamp, sizeof(stamp));
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&port->rx_mutex);
+    return rval;
+}
+
+static int link_waitinframe(ecx_portt *port, int idx, int timeout)
+{
+    int64_t deadline = now_us() + timeout;
+    int wkc;
+
+    // AF_XDP: busy-poll the RX ring, no syscall unless the kernel asks for a
+    // wakeup. Raw socket: each recvmsg() waits up to SOEM's socket timeout.
+    do
+    {
+        wkc = link_inframe(port, idx);
+    }
+    while (wkc <= EC_NOFRAME && now_us() < deadline);
+
+    return wkc;
+}
+
+int __wrap_ecx_outframe_red(ecx_portt *port, int idx)
+{
+    int rval;
+
+    if (port != &ecx_port)
+        return __real_ecx_outframe_red(port, idx);
+
+    int dc_frame = carries_dc_time(port, idx);
+    if (dc_frame && piggyback_queued > 0)
+        piggyback_attach(port, idx);
+
+    memset(frame_tx_stamp[idx], 0, sizeof(frame_tx_stamp[idx]));
+    memset(frame_rx_stamp[idx], 0, sizeof(frame_rx_stamp[idx]));
+    frame_rx_ns[idx] = 0;
+
+    if (link_timestamping != EC_LINK_TS_OFF)
+        pthread_mutex_lock(&tx_key_lock);
+    if (launch_stats.mode == EC_LINK_LAUNCH_TXTIME)
+    {
+        rval = txtime_outframe(port, idx, &frame_tx_ns[idx]);
+    }
+    else
+    {
+        if (launch_stats.mode == EC_LINK_LAUNCH_SPIN && launch_ns != 0)
+            spin_until_launch();
+        frame_tx_ns[idx] = now_ns();
+        rval = link_backend == LINK_XDP ? xdp_outframe(port, idx) : __real_ecx_outframe_red(port, idx);
+    }
+    if (link_timestamping != EC_LINK_TS_OFF)
+    {
+        if (rval >= 0)
+        {
+            tx_key_idx[tx_key % TX_KEY_RING].key = tx_key;
+            tx_key_idx[tx_key % TX_KEY_RING].idx = idx;
+            tx_key++;
+        }
+        pthread_mutex_unlock(&tx_key_lock);
+    }
+
+    last_tx_ns = frame_tx_ns[idx];
+    if (dc_frame)
+        dc_frame_tx_ns = frame_tx_ns[idx];
+    return rval;
+}
+
+int __wrap_ecx_waitinframe(ecx_portt *port, int idx, int timeout)
+{
+    int wkc;
+
+    if ((link_backend == LINK_XDP || link_timestamping != EC_LINK_TS_OFF) && port == &ecx_port)
+    {
+        wkc = link_waitinframe(port, idx, timeout);
+    }
+    else if (port->redstate == ECT_RED_NONE || port->redport == NULL || !process_data_frame(port, idx))
+    {
+        wkc = __real_ecx_waitinframe(port, idx, timeout);
+    }
+    else
+    {
+        int64_t start = now_us();
+        wkc = __real_ecx_waitinframe(port, idx, timeout);
+        red_account(port, idx, (now_us() - start) * 1000);
+    }
+
+    if (wkc > EC_NOFRAME && port == &ecx_port)
+        stamp_received(port, now_ns());
+    return wkc;
+}
+
+int __wrap_ecx_srconfirm(ecx_portt *port, int idx, int timeout)
+{
+    // SOEM's srconfirm sends through nicdrv's own ecx_outframe_red(), which
+    // the wrap does not reach: such a frame would bypass AF_XDP, the ETF
+    // qdisc drops it for lacking a launch time, and it would go missing from
+    // the OPT_ID count of transmit stamps
+    if (port != &ecx_port || (link_backend != LINK_XDP && launch_stats.mode != EC_LINK_LAUNCH_TXTIME &&
+                              link_timestamping == EC_LINK_TS_OFF))
+        return __real_ecx_srconfirm(port, idx, timeout);
+
+    // Same retry policy as SOEM: resend every EC_TIMEOUTRET until the overall
+    // timeout. Mailbox and state traffic has no launch time armed, so it is
+    // stamped to leave LAUNCH_LEAD_NS after the send call.
+    int64_t deadline = now_us() + timeout;
+    int wkc;
+    do
+    {
+        __wrap_ecx_outframe_red(port, idx);
+        wkc = __wrap_ecx_waitinframe(port, idx, timeout < EC_TIMEOUTRET ? timeout : EC_TIMEOUTRET);
+    }
+    while (wkc <= EC_NOFRAME && now_us() < deadline);
+
+    // Acyclic frames are stamped too; keep their stamps off the error queue
+    if (link_timestamping != EC_LINK_TS_OFF)
+        drain_errqueue();
+
+    return wkc;
+}
@@ -0,0 +1,235 @@
+/**
+ * Link-layer backend selection for SOEM
+ *
+ * SOEM moves every frame through three nicdrv entry points:
+ * ecx_outframe_red(), ecx_waitinframe() and ecx_srconfirm(). The Makefile
+ * links with -Wl,--wrap for each of them, so the wrappers in ec_link.c see
+ * every call made from inside the (static) SOEM library. With the default
+ * raw-socket backend the wrappers forward straight to SOEM; once another
+ * backend is opened, frame exchange is routed through it instead.
+ */
+
+#ifndef EC_LINK_H
+#define EC_LINK_H
+
+#include <stdint.h>
+#include "datagram.h"
+
+/**
+ * Cable redundancy statistics (ec_init_redundant only)
+ * In an intact ring the frame sent on the primary port returns on the
+ * secondary port and vice versa. After a line break each frame bounces
+ * back on its own port and SOEM resends the primary result through the
+ * secondary port, which costs a second partial round trip; that extra
+ * receive time is tracked separately as the break penalty. A frame that
+ * simply did not come back is a loss, not evidence of a break; the ring
+ * only counts as broken after several bounced frames in a row.
+ */
+typedef struct
+{
+    uint64_t frames;            // Cyclic frames received in redundant mode
+    uint64_t broken_frames;     // Of which bounced back on their own port
+    uint64_t lost_frames;       // Of which missing on a port, without a bounce
+    uint64_t breaks;            // Intact -> broken transitions
+    int      line_break;        // 1 while the ring is considered broken
+    int64_t  intact_rx_ns;      // Mean receive time, intact ring
+    int64_t  broken_rx_ns;      // Mean receive time, broken ring
+    int64_t  broken_rx_max_ns;  // Worst receive time, broken ring
+} ec_link_red_stats;
+
+/**
+ * Route all EtherCAT frames through an AF_XDP socket on `ifname`
+ * Must be called after ec_init() on the same interface and before any
+ * other thread talks to the slaves. Redundant mode is not supported.
+ * Returns 1 on success, 0 on failure (raw socket stays in use).
+ */
+int ec_link_open_xdp(const char *ifname, int queue, int force_copy);
+
+/**
+ * Return to the raw-socket backend and release backend resources
+ */
+void ec_link_close(void);
+
+/**
+ * Switch the raw socket(s) to non-blocking busy-poll receive
+ * SOEM's receive loop then spins on recv() instead of sleeping in the
+ * kernel between polls, and with SO_BUSY_POLL each recv() polls the NIC
+ * queue directly for up to `busy_poll_us`. The caller bounds the spin
+ * through the receive timeout. No-op for the AF_XDP backend, which
+ * always busy-polls.
+ * Returns 1 on success, 0 on failure.
+ */
+int ec_link_set_busy_poll(int busy_poll_us);
+
+/**
+ * 1 while the ring is considered broken
+ * Cheap enough to call every cycle.
+ */
+int ec_link_line_break(void);
+
+/**
+ * Snapshot of the cable redundancy statistics
+ */
+void ec_link_get_red_stats(ec_link_red_stats *stats);
+
+/**
+ * Round trip time of the last frame sent with buffer index `idx`
+ * Send time is taken when the frame is handed to the backend, receive
+ * time when the frame is first seen by the receive path. Returns -1 if
+ * the frame has not come back (yet).
+ */
+int64_t ec_link_frame_rtt_ns(int idx);
+
+/**
+ * Send time (CLOCK_MONOTONIC) of the most recent frame on the primary port
+ */
+int64_t ec_link_last_tx_ns(void);
+
+/**
+ * Send a frame holding only the precomputed datagram `d`, without waiting
+ * Goes out through the active backend ahead of anything sent later.
+ * Returns the buffer index to collect the frame with.
+ */
+int ec_link_send_datagram(const datagram *d);
+
+/**
+ * Wait up to `timeout_us` for a frame from ec_link_send_datagram() and
+ * release its index; returns its working counter (<= 0: no frame)
+ */
+int ec_link_collect_datagram(int idx, int timeout_us);
+
+/**
+ * Datagrams carried along with the cyclic process data
+ *
+ * With DC, the first frame of every process-data exchange holds the LRW
+ * followed by SOEM's FRMW of the reference clock's system time. SOEM
+ * reads that frame's working counter and DC time at fixed offsets, so
+ * further datagrams can ride behind them at no frame cost (for any other
+ * frame SOEM takes the working counter of the last datagram, which rules
+ * them out). Datagrams queued with ec_link_piggyback() are appended to
+ * the next such frame; their data and working counter can be read once
+ * the exchange has completed. Not in redundant mode.
+ */
+#define EC_LINK_PIGGYBACK_MAX  4
+
+/**
+ * Queue `d` for the next process-data frame carrying the DC time
+ * Returns its slot for ec_link_piggyback_result(), -1 if the queue is full.
+ */
+int ec_link_piggyback(const datagram *d);
+
+/**
+ * After ec_receive_processdata(): up to `len` bytes of the data slot
+ * `slot` returned with into `data` (may be NULL); returns its working
+ * counter, or -1 if it was not sent (frame full) or did not come back
+ * Valid until the next process-data frame with DC is sent.
+ */
+int ec_link_piggyback_result(int slot, void *data, int len);
+
+/**
+ * Send time (CLOCK_MONOTONIC; the launch time with SO_TXTIME) of the most
+ * recent process-data frame carrying the DC time
+ */
+int64_t ec_link_dc_frame_tx_ns(void);
+
+/**
+ * Launch-time scheduling of frames on the raw socket
+ *
+ * SO_TXTIME stamps every frame with the time it is to leave the NIC; an
+ * ETF qdisc on the interface (scripts/etf_setup.sh) holds it until then,
+ * in the NIC with launch-time offload, otherwise in the kernel. The
+ * cyclic task arms a launch time each cycle at a fixed offset from the
+ * cycle start, so its frames hit the wire at the same point of every
+ * cycle however late the task got to send them. Every other frame,
+ * including the mailbox and state traffic SOEM sends through
+ * ecx_srconfirm(), is stamped to leave shortly after its send call. Launch
+ * times handed to the qdisc never go backwards, which ETF requires.
+ *
+ * Without SO_TXTIME (old kernel) the cyclic task instead spins until the
+ * launch time before sending, which removes the wake-up jitter but not
+ * the send path's.
+ */
+#define EC_LINK_LAUNCH_OFF     0
+#define EC_LINK_LAUNCH_TXTIME  1       // SO_TXTIME + ETF qdisc
+#define EC_LINK_LAUNCH_SPIN    2       // Software: spin until the launch time
+
+// Socket priority of EtherCAT frames with launch-time scheduling on; the
+// ETF setup script maps it to the ETF queue
+#define EC_LINK_LAUNCH_PRIORITY  3
+
+typedef struct
+{
+    int      mode;              // EC_LINK_LAUNCH_*
+    uint64_t frames;            // Frames sent with an armed launch time
+    uint64_t late;              // Of which handed over after their launch time
+    uint64_t dropped;           // Reported by the qdisc (missed or invalid launch time)
+    int64_t  lead_min_ns;       // Least time between send call and launch
+} ec_link_launch_stats;
+
+/**
+ * Turn on launch-time scheduling for the raw socket on `ifname`
+ * Must be called after ec_init() and before the cyclic task starts, while
+ * no other thread is sending (in practice: once the slaves are in OP); not
+ * available with AF_XDP or in redundant mode. Without an ETF qdisc on the
+ * interface the kernel ignores launch times, so the cyclic task spins
+ * instead. Returns the mode in use, EC_LINK_LAUNCH_OFF on failure.
+ */
+int ec_link_enable_launch_time(const char *ifname);
+
+/**
+ * Frames sent by the calling thread from now on leave no earlier than
+ * `launch_ns` (CLOCK_MONOTONIC); 0 disarms
+ * A frame sent after its launch time leaves at once and counts as late.
+ */
+void ec_link_set_launch(int64_t launch_ns);
+
+/**
+ * Snapshot of the launch-time statistics, collecting qdisc error reports
+ */
+void ec_link_get_launch_stats(ec_link_launch_stats *stats);
+
+/**
+ * Socket timestamping of EtherCAT frames (SO_TIMESTAMPING)
+ *
+ * The round trip from ec_link_frame_rtt_ns() is taken in user space and
+ * includes the send path, the receive wake-up and whatever the scheduler
+ * adds. With timestamping on, every frame is also stamped when the driver
+ * (software) or the NIC (hardware) sends and receives it, so the wire
+ * round trip can be told apart from the host's share. Transmit stamps
+ * come back through the socket's error queue carrying the frame's
+ * OPT_ID number (no copy of the frame), which the send path maps
+ * to the EtherCAT index the receive stamp is filed under. Hardware
+ * stamping is turned on for every frame on the NIC (HWTSTAMP_FILTER_ALL)
+ * where the driver allows it, software stamps otherwise.
+ */
+#define EC_LINK_TS_OFF       0
+#define EC_LINK_TS_SOFTWARE  1
+#define EC_LINK_TS_HARDWARE  2
+
+/**
+ * Turn on timestamping on the raw socket bound to `ifname`
+ * Must be called after ec_init() while no other thread is sending (in
+ * practice: once the slaves are in OP); not available with AF_XDP or in
+ * redundant mode. Frames are then received by ec_link.c itself.
+ * Returns EC_LINK_TS_HARDWARE, EC_LINK_TS_SOFTWARE or EC_LINK_TS_OFF.
+ */
+int ec_link_enable_timestamping(const char *ifname);
+
+/**
+ * EC_LINK_TS_* in use
+ */
+int ec_link_timestamping(void);
+
+/**
+ * Wire round trip of the last frame sent with buffer index `idx`
+ * From its transmit and receive stamps, hardware if the NIC stamped both
+ * ways. Returns -1 if either stamp is missing.
+ */
+int64_t ec_link_frame_wire_rtt_ns(int idx);
+
+/**
+ * Human-readable name of the active backend, for status output
+ */
+const char *ec_link_name(void);
+
+#endif
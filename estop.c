@@ -0,0 +1,107 @@
+/**
+ * Emergency-stop channel
+ * See estop.h.
+ */
+
+#include <time.h>
+#include <stdatomic.h>
+#include "estop.h"
+#include "ec_link.h"
+
+// Trigger side: written from signal handlers and other threads
+static atomic_int pending = 0;
+static atomic_int pending_source = 0;
+static _Atomic int64_t pending_ns = 0;
+
+// Latch side: cyclic task only
+static estop_state state;
+
+// Broadcast path, precomputed at startup
+static datagram bcast;
+static int bcast_ready = 0;
+static int bcast_idx = -1;
+
+void estop_trigger(int source)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);     // Async-signal-safe
+
+    // First trigger wins; later ones must not move the reference time
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&pending_source, &expected, source))
+        atomic_store_explicit(&pending_ns, (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec, memory_order_relaxed);
+    atomic_store_explicit(&pending, 1, memory_order_release);
+}
+
+int estop_poll(shm_io_header *shm)
+{
+    if (state.latched)
+        return 1;
+
+    if (!atomic_load_explicit(&pending, memory_order_acquire))
+    {
+        if (shm == NULL || !atomic_load_explicit(&shm->estop, memory_order_acquire))
+            return 0;
+
+        state.source = ESTOP_SOURCE_SHM;
+        state.trigger_ns = atomic_load_explicit(&shm->estop_ns, memory_order_relaxed);
+    }
+    else
+    {
+        state.source = atomic_load(&pending_source);
+        state.trigger_ns = atomic_load_explicit(&pending_ns, memory_order_relaxed);
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    state.latched = 1;
+    state.seen_ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return 1;
+}
+
+void estop_frame_sent(int64_t tx_ns)
+{
+    if (state.latched && state.frame_ns == 0)
+        state.frame_ns = tx_ns;
+}
+
+void estop_drive_stopped(int64_t now_ns)
+{
+    if (state.latched && state.drive_ns == 0)
+        state.drive_ns = now_ns;
+}
+
+int estop_broadcast_prepare(uint16_t sm_addr, const void *image, uint16_t len, int ndrives)
+{
+    if (!datagram_build(&bcast, DATAGRAM_CMD_BWR, 0, sm_addr, image, len))
+        return 0;
+
+    state.bcast_expected = ndrives;
+    bcast_ready = 1;
+    return 1;
+}
+
+void estop_broadcast_send(void)
+{
+    if (!bcast_ready || bcast_idx >= 0)
+        return;
+
+    bcast_idx = ec_link_send_datagram(&bcast);
+    if (state.bcast_ns == 0)
+        state.bcast_ns = ec_link_last_tx_ns();
+    state.bcast_frames++;
+}
+
+void estop_broadcast_collect(int timeout_us)
+{
+    if (bcast_idx < 0)
+        return;
+
+    state.bcast_wkc = ec_link_collect_datagram(bcast_idx, timeout_us);
+    bcast_idx = -1;
+}
+
+void estop_get_state(estop_state *out)
+{
+    *out = state;
+}
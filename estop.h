@@ -0,0 +1,102 @@
+/**
+ * Emergency-stop channel
+ *
+ * An e-stop can be raised from a signal handler (SIGQUIT / SIGUSR1), from
+ * any thread, or by an external process through the shared-memory header
+ * (shm_io_estop()). Raising it stores the trigger time and sets an atomic
+ * flag; both are async-signal-safe.
+ *
+ * The cyclic task polls the flag with one atomic load at the top of every
+ * cycle, before the frame is sent. Once seen, the e-stop is latched and
+ * the quick stop goes out in that cycle's frame. Two latencies are
+ * recorded for the reaction-time report:
+ *
+ *   trigger -> frame   until the frame carrying the quick stop was handed
+ *                      to the NIC (ec_link send stamp)
+ *   trigger -> drive   until the drive reported it left Operation Enabled
+ *
+ * The latch holds until the program exits.
+ *
+ * Broadcast path (optional): when every slave is the same kind of drive
+ * with its output sync manager at the same address, a BWR datagram
+ * writing the whole quick-stop RxPDO image to that sync manager is
+ * precomputed at startup. While the e-stop is latched it is sent each
+ * cycle as its own minimal frame, ahead of the process data. Every drive
+ * then has the stop command a few microseconds into the cycle, whatever
+ * its position in the chain or in the process image. The cyclic task
+ * still writes the quick stop into every drive's PDO block as well, so
+ * the process-data frames that follow carry the same command.
+ */
+
+#ifndef ESTOP_H
+#define ESTOP_H
+
+#include <stdint.h>
+#include "shm_io.h"
+#include "datagram.h"
+
+typedef struct
+{
+    int      latched;
+    int      source;            // ESTOP_SOURCE_*
+    int64_t  trigger_ns;        // CLOCK_MONOTONIC at the trigger
+    int64_t  seen_ns;           // Picked up by the cyclic task
+    int64_t  frame_ns;          // Quick stop handed to the NIC
+    int64_t  drive_ns;          // Drive out of Operation Enabled (0 = not yet)
+
+    // Broadcast path
+    int64_t  bcast_ns;          // First broadcast frame handed to the NIC (0 = none)
+    int      bcast_wkc;         // Working counter of the last one
+    int      bcast_expected;    // Drives it should reach
+    uint64_t bcast_frames;
+} estop_state;
+
+#define ESTOP_SOURCE_SIGNAL  1
+#define ESTOP_SOURCE_API     2
+#define ESTOP_SOURCE_SHM     3
+
+/**
+ * Raise the e-stop; async-signal-safe
+ */
+void estop_trigger(int source);
+
+/**
+ * Cyclic task, top of the cycle: 1 if the e-stop is (now) latched
+ * One atomic load per call while nothing is pending; `shm` may be NULL.
+ */
+int estop_poll(shm_io_header *shm);
+
+/**
+ * Cyclic task: the frame of the latching cycle has been sent
+ */
+void estop_frame_sent(int64_t tx_ns);
+
+/**
+ * Cyclic task: the drive has left Operation Enabled
+ */
+void estop_drive_stopped(int64_t now_ns);
+
+/**
+ * Precompute the broadcast datagram: `len` bytes of `image` to sync manager
+ * address `sm_addr` of all `ndrives` slaves. Returns 1 on success.
+ */
+int estop_broadcast_prepare(uint16_t sm_addr, const void *image, uint16_t len, int ndrives);
+
+/**
+ * Cyclic task, after estop_poll() returned 1 and before the process data
+ * is sent: put the broadcast frame on the wire (no-op if not prepared)
+ */
+void estop_broadcast_send(void);
+
+/**
+ * Cyclic task, after the process data is received: collect the broadcast
+ * frame and record its working counter
+ */
+void estop_broadcast_collect(int timeout_us);
+
+/**
+ * Snapshot, for the report
+ */
+void estop_get_state(estop_state *state);
+
+#endif
@@ -0,0 +1,232 @@
+/**
+ * LRW frame layout and per-frame round trip times
+ * See frame_layout.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ethercat.h"
+#include "frame_layout.h"
+#include "ec_link.h"
+
+// Same per-frame limit SOEM applies when it cuts segments (room for the DC datagram)
+#define FRAME_CAPACITY  (EC_MAXLRWDATA - EC_FIRSTDCDATAGRAM)
+
+typedef struct
+{
+    uint16 slave;
+    uint8  type;                // FMMU type: 2 = outputs, 1 = inputs
+    uint32 size;
+    uint32 old_off;             // Offset in the image / logical range
+    uint32 new_off;
+    int    frame;
+} block;
+
+static frame_layout_stats stats[FRAME_LAYOUT_MAX_FRAMES];
+static uint8 sent_idx[FRAME_LAYOUT_MAX_FRAMES];
+static int sent_count;
+
+static int cmp_size_desc(const void *a, const void *b)
+{
+    const block *x = a, *y = b;
+    if (x->size != y->size)
+        return x->size < y->size ? 1 : -1;
+    return x->old_off < y->old_off ? -1 : 1;
+}
+
+static int cmp_placement(const void *a, const void *b)
+{
+    const block *x = a, *y = b;
+    if (x->frame != y->frame)
+        return x->frame - y->frame;
+    return x->old_off < y->old_off ? -1 : 1;
+}
+
+/**
+ * Point every FMMU of `b` at the block's new logical address
+ */
+static int move_block(const block *b, uint32 logstart)
+{
+    ec_slavet *s = &ec_slave[b->slave];
+    int32 delta = (int32)b->new_off - (int32)b->old_off;
+
+    for (int f = 0; f < s->FMMUunused && f < EC_MAXFMMU; f++)
+    {
+        ec_fmmut *fmmu = &s->FMMU[f];
+        if (fmmu->FMMUtype != b->type ||
+            fmmu->LogStart < logstart + b->old_off ||
+            fmmu->LogStart >= logstart + b->old_off + b->size)
+            continue;
+
+        uint32 log = htoel(fmmu->LogStart + delta);
+        if (ec_FPWR(s->configadr, ECT_REG_FMMU0 + (sizeof(ec_fmmut) * f), sizeof(log), &log, EC_TIMEOUTRET3) <= 0)
+            return 0;
+        fmmu->LogStart += delta;
+    }
+    return 1;
+}
+
+int frame_layout_optimize(uint8_t group, process_image *img)
+{
+    ec_groupt *g = &ec_group[group];
+    int nblocks = 0;
+    uint32 total = 0;
+
+    if (g->blockLRW || g->nsegments <= 1)
+        return g->nsegments;
+
+    block *blocks = calloc(2 * (ec_slavecount + 1), sizeof(block));
+    if (blocks == NULL)
+        return g->nsegments;
+
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        ec_slavet *s = &ec_slave[slave];
+        if (s->group != group)
+            continue;
+
+        // Bit-packed slaves share bytes with their neighbours and cannot move alone
+        if ((s->Obits % 8) || s->Ostartbit || (s->Ibits % 8) || s->Istartbit)
+        {
+            printf("  Frame layout: slave %d is bit-packed, keeping SOEM's layout\n", slave);
+            free(blocks);
+            return g->nsegments;
+        }
+
+        if (s->Obytes)
+            blocks[nblocks++] = (block){ slave, 2, s->Obytes, (uint32)(s->outputs - img->base), 0, 0 };
+        if (s->Ibytes)
+            blocks[nblocks++] = (block){ slave, 1, s->Ibytes, (uint32)(s->inputs - img->base), 0, 0 };
+    }
+
+    for (int i = 0; i < nblocks; i++)
+        total += blocks[i].size;
+    if (total != img->used)
+    {
+        printf("  Frame layout: slave blocks cover %u of %zu bytes, keeping SOEM's layout\n",
+               total, img->used);
+        free(blocks);
+        return g->nsegments;
+    }
+
+    // First-fit decreasing
+    uint32 fill[EC_MAXIOSEGMENTS] = { 0 };
+    int frames = 0;
+    qsort(blocks, nblocks, sizeof(block), cmp_size_desc);
+    for (int i = 0; i < nblocks; i++)
+    {
+        int f = 0;
+        while (f < frames && fill[f] + blocks[i].size > FRAME_CAPACITY)
+            f++;
+        if (f == frames)
+            frames++;
+        fill[f] += blocks[i].size;
+        blocks[i].frame = f;
+    }
+
+    if (frames >= g->nsegments || frames > EC_MAXIOSEGMENTS)
+    {
+        printf("  Frame layout: %d frame(s) already minimal\n", g->nsegments);
+        free(blocks);
+        return g->nsegments;
+    }
+
+    // Lay frames out in order, keeping SOEM's slave order inside each frame
+    qsort(blocks, nblocks, sizeof(block), cmp_placement);
+    uint32 off = 0;
+    for (int i = 0; i < nblocks; i++)
+    {
+        blocks[i].new_off = off;
+        off += blocks[i].size;
+    }
+
+    for (int i = 0; i < nblocks; i++)
+    {
+        if (!move_block(&blocks[i], g->logstartaddr))
+        {
+            printf("  Frame layout: FMMU update of slave %d failed\n", blocks[i].slave);
+            free(blocks);
+            return -1;
+        }
+
+        ec_slavet *s = &ec_slave[blocks[i].slave];
+        if (blocks[i].type == 2)
+            s->outputs = img->base + blocks[i].new_off;
+        else
+            s->inputs = img->base + blocks[i].new_off;
+    }
+
+    printf("  Frame layout: %d -> %d frame(s) per cycle (", g->nsegments, frames);
+    for (int f = 0; f < frames; f++)
+    {
+        g->IOsegment[f] = fill[f];
+        printf("%s%u", f ? " + " : "", fill[f]);
+    }
+    printf(" bytes)\n");
+
+    g->nsegments = frames;
+
+    free(blocks);
+    return frames;
+}
+
+void frame_layout_sent(void)
+{
+    ec_idxstackT *stack = ecx_context.idxstack;
+
+    sent_count = stack->pushed < FRAME_LAYOUT_MAX_FRAMES ? stack->pushed : FRAME_LAYOUT_MAX_FRAMES;
+    memcpy(sent_idx, stack->idx, sent_count);
+}
+
+void frame_layout_received(void)
+{
+    for (int f = 0; f < sent_count; f++)
+    {
+        frame_layout_stats *st = &stats[f];
+        int64_t rtt = ec_link_frame_rtt_ns(sent_idx[f]);
+
+        if (rtt < 0)
+        {
+            st->lost++;
+            continue;
+        }
+
+        if (st->rtt_min_ns == 0 || rtt < st->rtt_min_ns)
+            st->rtt_min_ns = rtt;
+        if (rtt > st->rtt_max_ns)
+            st->rtt_max_ns = rtt;
+        st->rtt_sum_ns += rtt;
+        st->samples++;
+
+        int64_t wire = ec_link_frame_wire_rtt_ns(sent_idx[f]);
+        if (wire >= 0 && wire <= rtt)
+        {
+            if (wire > st->wire_rtt_max_ns)
+                st->wire_rtt_max_ns = wire;
+            if (rtt - wire > st->host_max_ns)
+                st->host_max_ns = rtt - wire;
+            st->wire_rtt_sum_ns += wire;
+            st->host_sum_ns += rtt - wire;
+            st->wire_samples++;
+        }
+    }
+    sent_count = 0;
+}
+
+int frame_layout_get_stats(frame_layout_stats *out, int max)
+{
+    // Live segment count: hot-plug may have added a frame
+    int n = ec_group[0].nsegments < FRAME_LAYOUT_MAX_FRAMES ? ec_group[0].nsegments : FRAME_LAYOUT_MAX_FRAMES;
+
+    for (int f = 0; f < n && f < max; f++)
+    {
+        out[f] = stats[f];
+        out[f].bytes = ec_group[0].IOsegment[f];
+        stats[f].rtt_min_ns = 0;
+        stats[f].rtt_max_ns = 0;
+        stats[f].wire_rtt_max_ns = 0;
+        stats[f].host_max_ns = 0;
+    }
+    return n;
+}
@@ -0,0 +1,73 @@
+/**
+ * LRW frame layout and per-frame round trip times
+ *
+ * A group's process image goes out as one LRW datagram per IOsegment, at
+ * most one Ethernet frame each. SOEM cuts the segments in slave order: all
+ * outputs, then all inputs, a new frame starting whenever the next slave's
+ * block does not fit. On large chains that leaves a gap at the end of each
+ * frame and can cost a whole extra frame per cycle.
+ *
+ * frame_layout_optimize() repacks the slaves' output and input blocks
+ * into as few frames as possible (first-fit decreasing), then moves each
+ * block's FMMUs to its new logical address. It runs once, after mapping
+ * and before the first exchange. The result is only applied if it saves
+ * at least one frame.
+ *
+ * SOEM already sends all frames of a group back to back and only then
+ * waits for them, so the frames' round trips overlap. frame_layout_sent()
+ * and frame_layout_received() bracket each exchange and record every
+ * frame's round trip time, and its wire round trip where the socket
+ * timestamps the frames.
+ */
+
+#ifndef FRAME_LAYOUT_H
+#define FRAME_LAYOUT_H
+
+#include <stdint.h>
+#include "process_image.h"
+
+#define FRAME_LAYOUT_MAX_FRAMES  16
+
+typedef struct
+{
+    uint32_t bytes;             // LRW data carried
+    uint64_t samples;
+    uint64_t lost;              // Exchanges in which this frame did not return
+    int64_t  rtt_min_ns;
+    int64_t  rtt_max_ns;
+    int64_t  rtt_sum_ns;
+
+    // With socket timestamping (ec_link.h): the round trip split into the
+    // wire's share and the host's (send path, receive wake-up)
+    uint64_t wire_samples;
+    int64_t  wire_rtt_max_ns;
+    int64_t  wire_rtt_sum_ns;
+    int64_t  host_max_ns;
+    int64_t  host_sum_ns;
+} frame_layout_stats;
+
+/**
+ * Repack `group`'s process image into fewer frames if possible
+ * Slaves must be in SAFE-OP or below with no exchange done yet. Groups
+ * with bit-packed slaves or separate LRD/LWR (blockLRW) keep SOEM's
+ * layout. Returns the number of frames per exchange.
+ */
+int frame_layout_optimize(uint8_t group, process_image *img);
+
+/**
+ * Call right after ec_send_processdata(): notes the frames in flight
+ */
+void frame_layout_sent(void);
+
+/**
+ * Call right after ec_receive_processdata(): records each frame's RTT
+ */
+void frame_layout_received(void);
+
+/**
+ * Per-frame statistics of the cyclic exchange, resetting min/max
+ * Fills up to `max` entries, returns the number of frames.
+ */
+int frame_layout_get_stats(frame_layout_stats *stats, int max);
+
+#endif
@@ -0,0 +1,306 @@
+/**
+ * EtherCAT link-layer round-trip benchmark
+ *
+ * Measures frame round-trip time through the raw-socket path (what SOEM
+ * uses by default) and through the AF_XDP path, without EtherCAT hardware:
+ * run the reflector on one end of a veth pair and the pinger on the other
+ * (scripts/veth_bench.sh does the setup).
+ *
+ * Usage:
+ *   sudo ./link_bench reflect <interface>
+ *   sudo ./link_bench ping <interface> [-x] [-c] [-n count] [-s bytes] [-i interval_us]
+ *
+ *     -x  use AF_XDP instead of the raw socket
+ *     -c  force AF_XDP copy mode
+ *
+ * The reflector plays the part of a slave chain: every datagram in the
+ * frame gets its working counter bumped and the frame is sent back.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include "xdp_socket.h"
+
+#define ETH_P_ECAT      0x88A4
+#define ETH_HDR_LEN     14
+#define ECAT_HDR_LEN    2
+#define DGRAM_HDR_LEN   10
+#define WKC_LEN         2
+#define CMD_LRW         12
+#define MAX_FRAME       1518
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int open_raw(const char *ifname)
+{
+    struct sockaddr_ll sll;
+    struct timeval timeout = { 0, 1 };   // Same 1 us receive timeout SOEM uses
+
+    int sock = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ECAT));
+    if (sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_ifindex = if_nametoindex(ifname);
+    sll.sll_protocol = htons(ETH_P_ECAT);
+    if (sll.sll_ifindex == 0 || bind(sock, (struct sockaddr *)&sll, sizeof(sll)) < 0)
+    {
+        perror("bind");
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/**
+ * Build one frame holding a single LRW datagram of `data_len` bytes
+ */
+static int build_frame(uint8_t *frame, int data_len, uint8_t index)
+{
+    memset(frame, 0, MAX_FRAME);
+    memset(frame, 0xff, 6);                         // Broadcast destination
+    frame[6] = 0x01; frame[7] = 0x01;               // SOEM primary source MAC
+    frame[8] = 0x01; frame[9] = 0x01;
+    frame[10] = 0x01; frame[11] = 0x01;
+    frame[12] = ETH_P_ECAT >> 8;
+    frame[13] = ETH_P_ECAT & 0xff;
+
+    uint16_t elength = (DGRAM_HDR_LEN + data_len + WKC_LEN) | 0x1000;
+    uint8_t *p = frame + ETH_HDR_LEN;
+    p[0] = elength & 0xff;
+    p[1] = elength >> 8;
+    p[2] = CMD_LRW;
+    p[3] = index;
+    p[8] = data_len & 0xff;
+    p[9] = (data_len >> 8) & 0x07;
+
+    int len = ETH_HDR_LEN + ECAT_HDR_LEN + DGRAM_HDR_LEN + data_len + WKC_LEN;
+    return len < 60 ? 60 : len;
+}
+
+/**
+ * Reflect every EtherCAT frame, bumping each datagram's working counter
+ */
+static int run_reflector(const char *ifname)
+{
+    uint8_t frame[MAX_FRAME];
+    struct sockaddr_ll from;
+    socklen_t fromlen;
+
+    int sock = open_raw(ifname);
+    if (sock < 0)
+        return 1;
+
+    // Block in recv: the reflector is not what is being measured
+    struct timeval none = { 0, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &none, sizeof(none));
+
+    printf("Reflecting EtherCAT frames on %s (Ctrl+C to stop)\n", ifname);
+
+    for (;;)
+    {
+        fromlen = sizeof(from);
+        int len = recvfrom(sock, frame, sizeof(frame), 0, (struct sockaddr *)&from, &fromlen);
+        if (len < ETH_HDR_LEN + ECAT_HDR_LEN || from.sll_pkttype == PACKET_OUTGOING)
+            continue;
+
+        // Walk the datagram chain
+        int off = ETH_HDR_LEN + ECAT_HDR_LEN;
+        for (;;)
+        {
+            if (off + DGRAM_HDR_LEN > len)
+                break;
+            uint16_t dlen = frame[off + 6] | (frame[off + 7] << 8);
+            int data_len = dlen & 0x07ff;
+            int wkc_off = off + DGRAM_HDR_LEN + data_len;
+            if (wkc_off + WKC_LEN > len)
+                break;
+
+            uint16_t wkc = frame[wkc_off] | (frame[wkc_off + 1] << 8);
+            wkc += (frame[off] == CMD_LRW) ? 3 : 1;
+            frame[wkc_off] = wkc & 0xff;
+            frame[wkc_off + 1] = wkc >> 8;
+
+            if (!(dlen & 0x8000))
+                break;
+            off = wkc_off + WKC_LEN;
+        }
+
+        send(sock, frame, len, 0);
+    }
+
+    return 0;
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int run_pinger(const char *ifname, int use_xdp, int force_copy,
+                      int count, int data_len, int interval_us)
+{
+    uint8_t tx[MAX_FRAME];
+    uint8_t rx[MAX_FRAME];
+    xdp_socket xsk;
+    int sock = -1;
+    int lost = 0;
+
+    int64_t *rtt = calloc(count, sizeof(int64_t));
+    if (rtt == NULL)
+        return 1;
+
+    if (use_xdp)
+    {
+        if (xdp_socket_open(&xsk, ifname, 0, force_copy ? XDP_SOCKET_FORCE_COPY : 0))
+            return 1;
+        printf("Backend: AF_XDP (%s, %s mode)\n",
+               xsk.zerocopy ? "zero-copy" : "copy",
+               xsk.driver_mode ? "native" : "generic");
+    }
+    else
+    {
+        sock = open_raw(ifname);
+        if (sock < 0)
+            return 1;
+        printf("Backend: raw socket\n");
+    }
+
+    printf("Frames: %d x %d bytes process data, %d us interval\n\n", count, data_len, interval_us);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    int samples = 0;
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t index = i & 0x0f;
+        int len = build_frame(tx, data_len, index);
+
+        int64_t t0 = now_ns();
+        int64_t deadline = t0 + 10000000;   // 10 ms
+        int got = 0;
+
+        if (use_xdp)
+            xdp_socket_send(&xsk, tx, len);
+        else
+            send(sock, tx, len, 0);
+
+        while (!got && now_ns() < deadline)
+        {
+            int n = use_xdp ? xdp_socket_recv(&xsk, rx, sizeof(rx))
+                            : recv(sock, rx, sizeof(rx), 0);
+            if (n > ETH_HDR_LEN + 3 && rx[ETH_HDR_LEN + 3] == index)
+                got = 1;
+        }
+
+        if (got)
+            rtt[samples++] = now_ns() - t0;
+        else
+            lost++;
+
+        next.tv_nsec += interval_us * 1000L;
+        while (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    if (samples > 0)
+    {
+        int64_t sum = 0;
+        for (int i = 0; i < samples; i++)
+            sum += rtt[i];
+        qsort(rtt, samples, sizeof(int64_t), cmp_int64);
+
+        printf("RTT (us): min %.1f | avg %.1f | p50 %.1f | p99 %.1f | p99.9 %.1f | max %.1f\n",
+               rtt[0] / 1000.0,
+               (double)sum / samples / 1000.0,
+               rtt[samples / 2] / 1000.0,
+               rtt[(int)(samples * 0.99)] / 1000.0,
+               rtt[(int)(samples * 0.999)] / 1000.0,
+               rtt[samples - 1] / 1000.0);
+    }
+    printf("Received %d/%d frames (%d lost)\n", samples, count, lost);
+
+    if (use_xdp)
+        xdp_socket_close(&xsk);
+    else
+        close(sock);
+    free(rtt);
+
+    return lost == count;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s reflect <interface>\n", argv[0]);
+        printf("       %s ping <interface> [-x] [-c] [-n count] [-s bytes] [-i interval_us]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "reflect") == 0)
+        return run_reflector(argv[2]);
+
+    if (strcmp(argv[1], "ping") != 0)
+    {
+        printf("Unknown mode: %s\n", argv[1]);
+        return 1;
+    }
+
+    int use_xdp = 0;
+    int force_copy = 0;
+    int count = 10000;
+    int data_len = 32;
+    int interval_us = 1000;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-x") == 0)
+            use_xdp = 1;
+        else if (strcmp(argv[i], "-c") == 0)
+            force_copy = 1;
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            data_len = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            interval_us = atoi(argv[++i]);
+    }
+
+    if (count <= 0 || data_len <= 0 || data_len > 1486)
+    {
+        printf("Invalid count or frame size\n");
+        return 1;
+    }
+
+    return run_pinger(argv[2], use_xdp, force_copy, count, data_len, interval_us);
+}
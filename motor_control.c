@@ -3,17 +3,53 @@
  * For Linux with SOEM library
  *
  * Compile:
- *   gcc motor_control.c -I/path/to/SOEM/soem -L/path/to/SOEM/build/lib -lsoem -pthread -lrt -o motor_control
+ *   make    (links statically against SOEM with the ec_link.c wrappers)
  *
  * Run:
- *   sudo ./motor_control [network_interface]
+ *   sudo ./motor_control [options] [network_interface]
  *
  *   Without interface argument: Auto-detects interface with EtherCAT slave
  *   With interface: Uses specified interface
  *
+ *   Options:
+ *     -x, --xdp            Exchange frames through AF_XDP instead of a raw socket
+ *     -c, --xdp-copy       Force AF_XDP copy mode (no zero-copy attempt)
+ *     -q, --xdp-queue N    NIC RX queue to bind the AF_XDP socket to (default 0)
+ *     -b, --busy-poll[=US] Spin on a non-blocking socket (SO_BUSY_POLL=US, default 50)
+ *     -r, --rx-budget US   Receive deadline after cycle start (default: half a cycle)
+ *     -p, --pipeline       Send last cycle's outputs first, compute while the frame is
+ *                          in flight (input-to-output latency: 2 cycles instead of 1)
+ *     -R, --redundant IF2  Cable redundancy: close the ring back into a second NIC
+ *     -H, --hotplug        Detect slaves added to / removed from the chain at runtime
+ *     -G, --huge-pages     Back the process image with a huge page
+ *     -S, --slow SLAVES    Exchange these slaves (e.g. "2,4-6") in a separate, slower frame
+ *     -d, --slow-div N     Slow frame every N cycles (default 8)
+ *     -F, --pack-frames    Repack the process image into as few frames as possible
+ *     -C, --config FILE    Load settings from FILE (see motor_control.conf); SIGHUP reloads
+ *                          targets and limits
+ *     -M, --shm NAME       Exchange setpoints and feedback with other processes through
+ *                          the shared-memory object NAME (e.g. /motor_control)
+ *     -E, --estop-broadcast
+ *                          On e-stop, also broadcast the quick stop to every drive in
+ *                          one precomputed datagram ahead of the process data
+ *     -L, --launch-offset US
+ *                          Launch the cyclic frames exactly US after the cycle start
+ *                          (SO_TXTIME + ETF qdisc, see scripts/etf_setup.sh)
+ *     -t, --timestamps     Timestamp frames in the NIC or driver (SO_TIMESTAMPING) and
+ *                          split the round trip into wire and host time
+ *     -T, --rt-tune        Tune the host for real time before starting (C-states, governor,
+ *                          NIC IRQ affinity, rx coalescing); restored on exit
+ *     -D, --dc-steer       Steer the DC reference clock from the host clock instead of
+ *                          following it
+ *
  *   Examples:
  *     sudo ./motor_control          # Auto-detect
  *     sudo ./motor_control eth0     # Use eth0
+ *     sudo ./motor_control -x eth0  # Use eth0 through AF_XDP
+ *
+ *   Signals: SIGINT stops with a controlled deceleration, SIGQUIT (Ctrl+\) or
+ *   SIGUSR1 is an emergency stop (quick stop in the next frame), SIGHUP reloads
+ *   the configuration.
  */
 
 #include <stdio.h>
@@ -23,9 +59,26 @@
 #include <time.h>
 #include <pthread.h>
 #include <signal.h>
+#include <getopt.h>
 #include <ifaddrs.h>
 #include <net/if.h>
 #include "ethercat.h"
+#include "ec_link.h"
+#include "cycle.h"
+#include "wkc_monitor.h"
+#include "supervisor.h"
+#include "process_image.h"
+#include "topology.h"
+#include "pd_group.h"
+#include "frame_layout.h"
+#include "axis_units.h"
+#include "config.h"
+#include "shm_io.h"
+#include "watchdog.h"
+#include "estop.h"
+#include "rt_preflight.h"
+#include "dc_clock.h"
+#include "dc_monitor.h"
 
 // Motor vendor/product from ESI
 #define MOTOR_VENDOR_ID  0x00202008
@@ -55,16 +108,113 @@ typedef struct __attribute__((__packed__))
 } InputPDO;
 
 // Global variables
-static int run_flag = 1;
-static char io_map[4096];
-static ec_slavet ec_slave[EC_MAXSLAVE];
+static volatile sig_atomic_t run_flag = 1;
+static process_image io_map;
+static int io_map_flags = 0;
 static int expected_wkc;
 
-// Signal handler
+// Cycle time, shared by DC SYNC0 and the cyclic task (from the configuration)
+static uint32_t cycle_time_ns;
+
+// Slave position of the motor axis (first [axis] of the configuration)
+static uint16 motor_slave = 1;
+
+// Quick stop option code (0x605A): stop on the quick-stop ramp, stay in Quick Stop Active
+#define QUICK_STOP_OPTION      6
+
+// Shutdown: standstill is |actual velocity| below this for STANDSTILL_CYCLES cycles
+#define STANDSTILL_RPM         0.5
+#define STANDSTILL_CYCLES      5
+
+// Working-counter supervision: diagnose after this many consecutive wrong cycles
+#define WKC_MISS_THRESHOLD  3
+
+// Slave recovery: supervisor polling interval and failed attempts per slave
+#define SUPERVISOR_PERIOD_US   10000
+#define SUPERVISOR_MAX_TRIES   5
+
+// Hot-plug: interval between topology scans
+#define TOPOLOGY_SCAN_US       500000
+
+// DC startup drift compensation: ARMW budget and target clock difference
+#define DC_CONVERGE_DATAGRAMS  15000
+#define DC_CONVERGE_TARGET_NS  100
+
+// DC sync monitor in OP: event when a slave's 0x092C exceeds this
+#define DC_SYNC_THRESHOLD_NS   1000
+
+// Slow process-data group (SOEM group 1)
+#define SLOW_GROUP             1
+#define SLOW_GROUP_DIVIDER     8
+
+// Link-layer options
+static int use_xdp = 0;
+static int xdp_force_copy = 0;
+static int xdp_queue = 0;
+static int busy_poll_us = 0;              // 0 = blocking receive
+static int rx_budget_us = 0;              // 0 = half a cycle
+
+// Pipelined cycle: frame N+1 is on the wire while the inputs of frame N are processed
+static int pipeline = 0;
+static process_image pipeline_outputs;    // Outputs kept aside across the pipelined receive
+
+// Cable redundancy: secondary NIC the end of the chain is wired back to
+static char *ifname_red = NULL;
+
+// Hot-plug detection
+static int hotplug = 0;
+
+// Slaves moved out of the fast frame
+static char *slow_slaves = NULL;
+static int slow_divider = SLOW_GROUP_DIVIDER;
+
+// Frame layout optimization for images spanning several frames
+static int pack_frames = 0;
+
+// Configuration file, if any
+static char *config_file = NULL;
+
+// Shared-memory interface for external controllers
+static char *shm_name = NULL;
+static shm_io_header *shm = NULL;
+
+// E-stop: also broadcast the quick stop in its own datagram
+static int estop_broadcast = 0;
+
+// Host tuning for real time (rt_preflight.h), undone at exit
+static int rt_tune = 0;
+
+// Launch time of the cyclic frames after the cycle start, 0 = send at once
+static int64_t launch_offset_ns = 0;
+
+// Socket timestamps of the cyclic frames: wire vs host round trip
+static int timestamps = 0;
+
+// DC reference clock follows the host clock (dc_clock.h)
+static int dc_steer = 0;
+
+// Signal handler; async-signal-safe calls only
 void signal_handler(int sig)
 {
+    static const char stopping[] = "\nStopping...\n";
+    static const char estop[] = "\n🛑 E-STOP\n";
+
+    if (sig == SIGHUP)
+    {
+        config_request_reload();
+        return;
+    }
+    if (sig == SIGQUIT || sig == SIGUSR1)
+    {
+        estop_trigger(ESTOP_SOURCE_SIGNAL);
+        ssize_t n = write(STDOUT_FILENO, estop, sizeof(estop) - 1);
+        (void)n;
+        return;
+    }
+
     run_flag = 0;
-    printf("\nStopping...\n");
+    ssize_t n = write(STDOUT_FILENO, stopping, sizeof(stopping) - 1);
+    (void)n;
 }
 
 /**
@@ -152,11 +302,178 @@ char* detect_ethercat_interface(void)
     return NULL;
 }
 
-// Calculate 10 RPM in pulses/second
-// Formula from manual: RPM = (pulses * 60) / 131072
-// Therefore: pulses = RPM * 131072 / 60
-#define TARGET_RPM 10
-#define TARGET_VELOCITY ((TARGET_RPM * 131072) / 60)  // = 21845 pulses/s
+// Scaling comes from the configuration. Formula from manual: RPM = (pulses * 60) / 131072
+#define RPM_TO_RADS (2.0 * M_PI / 60.0)
+#define RADS_TO_RPM (60.0 / (2.0 * M_PI))
+
+// SI <-> drive unit scale factors of the motor axis
+static axis_units motor_units;
+
+static int is_motor(uint16_t slave)
+{
+    return ec_slave[slave].eep_man == MOTOR_VENDOR_ID && ec_slave[slave].eep_id == MOTOR_PRODUCT_ID &&
+           ec_slave[slave].outputs != NULL && ec_slave[slave].Obytes >= sizeof(OutputPDO);
+}
+
+/**
+ * E-stop, process-data path: quick stop into every drive's output block
+ */
+static void quick_stop_all(void)
+{
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        if (!is_motor(slave))
+            continue;
+        OutputPDO *out = (OutputPDO *)ec_slave[slave].outputs;
+        out->control_word = 0x0B;
+        out->target_velocity = 0;
+    }
+}
+
+/**
+ * E-stop, broadcast path: precompute the BWR of a quick-stop RxPDO image
+ * Only possible if every slave is a drive with the same output sync manager.
+ */
+static void prepare_estop_broadcast(const OutputPDO *template)
+{
+    uint16 sm_addr = etohs(ec_slave[motor_slave].SM[2].StartAddr);
+    int drives = 0;
+
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        if (!is_motor(slave) || etohs(ec_slave[slave].SM[2].StartAddr) != sm_addr ||
+            etohs(ec_slave[slave].SM[2].SMlength) != sizeof(OutputPDO))
+        {
+            printf("  Warning: slave %d (%s) is not a drive with RxPDO at 0x%04X, e-stop broadcast off\n",
+                   slave, ec_slave[slave].name, sm_addr);
+            return;
+        }
+        drives++;
+    }
+
+    OutputPDO stop = *template;
+    stop.control_word = 0x0B;
+    stop.target_position = 0;
+    stop.target_velocity = 0;
+    stop.target_torque = 0;
+    if (estop_broadcast_prepare(sm_addr, &stop, sizeof(stop), drives))
+        printf("✓ E-stop broadcast: BWR of %zu B to SM2 at 0x%04X (%d drives)\n\n", sizeof(stop), sm_addr, drives);
+}
+
+/**
+ * Pipelined receive of the frame sent one cycle ago
+ * With the non-overlapping map SOEM copies the whole returned LRW block,
+ * outputs included, back into the image. Those are the outputs that frame
+ * carried; the ones computed since must survive to leave with the next
+ * frame, so they are put aside across the receive.
+ */
+static int receive_pipelined(int timeout_us)
+{
+    size_t n = ec_group[0].Obytes < pipeline_outputs.size ? ec_group[0].Obytes : pipeline_outputs.size;
+
+    memcpy(pipeline_outputs.base, ec_group[0].outputs, n);
+    int wkc = ec_receive_processdata(timeout_us);
+    memcpy(ec_group[0].outputs, pipeline_outputs.base, n);
+    return wkc;
+}
+
+/**
+ * Process-data frames of the current cycle, launched at the -L offset
+ * from the cycle start when launch-time scheduling is on; with -D they
+ * carry the host time to the DC reference clock, and in OP one slave's
+ * DC sync read
+ */
+static void send_processdata(const cycle_sched *sched)
+{
+    if (launch_offset_ns > 0)
+        ec_link_set_launch(sched->start_ns + launch_offset_ns);
+    dc_clock_steer(launch_offset_ns > 0 ? sched->start_ns + launch_offset_ns : cycle_now_ns());
+    dc_monitor_queue();
+    ec_send_processdata();
+    ec_link_set_launch(0);
+}
+
+/**
+ * Per-slave setup done in PRE-OP / SAFE-OP over SDO
+ * Also used by the topology module for slaves plugged in at runtime.
+ */
+static int setup_slave(uint16_t slave)
+{
+    // Interpolation time period (0x60C2): value :01 x 10^index :02 seconds
+    uint32_t period_us = cycle_time_ns / 1000;
+    int8 exponent = -3;
+    uint32_t unit_us = 1000;
+    while (period_us % unit_us != 0 || period_us / unit_us > 255)
+    {
+        exponent--;
+        unit_us /= 10;
+    }
+    uint8 interp_period = period_us / unit_us;
+
+    int wkc_sdo = 1;
+    if (exponent != -3)
+        wkc_sdo = ec_SDOwrite(slave, 0x60C2, 0x02, FALSE, sizeof(exponent), &exponent, EC_TIMEOUTRXM);
+    if (wkc_sdo > 0)
+        wkc_sdo = ec_SDOwrite(slave, 0x60C2, 0x01, FALSE, sizeof(interp_period), &interp_period, EC_TIMEOUTRXM);
+    if (wkc_sdo > 0)
+        printf("  ✓ Interpolation period set to %u us\n", period_us);
+    else
+        printf("  Warning: Could not set interpolation period\n");
+
+    // Stale setpoints are answered with a quick stop; make it a controlled one
+    int16 quick_stop = QUICK_STOP_OPTION;
+    if (ec_SDOwrite(slave, 0x605A, 0x00, FALSE, sizeof(quick_stop), &quick_stop, EC_TIMEOUTRXM) <= 0)
+        printf("  Warning: Could not set quick stop option code (0x605A)\n");
+
+    // Quick-stop deceleration (0x6085) in counts/s^2, from the configured RPM/s
+    const config_axis *axis = config_axis_for_slave(slave);
+    if (axis != NULL)
+    {
+        uint32 decel = (uint32)(axis->stop_decel_rpm_s / 60.0 * axis->counts_per_rev * axis->gear_ratio);
+        if (ec_SDOwrite(slave, 0x6085, 0x00, FALSE, sizeof(decel), &decel, EC_TIMEOUTRXM) > 0)
+            printf("  ✓ Quick stop deceleration: %.0f RPM/s (%u counts/s²)\n", axis->stop_decel_rpm_s, decel);
+        else
+            printf("  Warning: Could not set quick stop deceleration (0x6085)\n");
+    }
+
+    // Outputs held by the slave itself if the master stops sending
+    uint32_t sm_watchdog_ms = config_get()->sm_watchdog_ms;
+    if (watchdog_sm_configure(slave, sm_watchdog_ms))
+    {
+        if (sm_watchdog_ms > 0)
+            printf("  ✓ SM watchdog: %u ms\n", sm_watchdog_ms);
+    }
+    else
+    {
+        printf("  Warning: Could not set SM watchdog (0x0400/0x0420)\n");
+    }
+    return wkc_sdo > 0;
+}
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [options] [interface]\n", prog);
+    printf("  -x, --xdp            Exchange frames through AF_XDP instead of a raw socket\n");
+    printf("  -c, --xdp-copy       Force AF_XDP copy mode (no zero-copy attempt)\n");
+    printf("  -q, --xdp-queue N    NIC RX queue for the AF_XDP socket (default 0)\n");
+    printf("  -b, --busy-poll[=US] Spin on a non-blocking socket (SO_BUSY_POLL=US, default 50)\n");
+    printf("  -r, --rx-budget US   Receive deadline after cycle start (default: half a cycle)\n");
+    printf("  -p, --pipeline       Overlap frame round trip with computation (2 cycles input-to-output)\n");
+    printf("  -R, --redundant IF2  Cable redundancy with a second NIC closing the ring\n");
+    printf("  -H, --hotplug        Detect slaves added to / removed from the chain at runtime\n");
+    printf("  -G, --huge-pages     Back the process image with a huge page\n");
+    printf("  -S, --slow SLAVES    Exchange these slaves (e.g. \"2,4-6\") in a separate, slower frame\n");
+    printf("  -d, --slow-div N     Slow frame every N cycles (default %d)\n", SLOW_GROUP_DIVIDER);
+    printf("  -F, --pack-frames    Repack the process image into as few frames as possible\n");
+    printf("  -C, --config FILE    Load settings from FILE; SIGHUP reloads targets and limits\n");
+    printf("  -M, --shm NAME       Setpoint/feedback shared memory for external controllers\n");
+    printf("  -E, --estop-broadcast  Broadcast the e-stop quick stop to all drives in one datagram\n");
+    printf("  -L, --launch-offset US  Launch cyclic frames US after cycle start (SO_TXTIME/ETF)\n");
+    printf("  -t, --timestamps     Split frame round trip into wire and host time (SO_TIMESTAMPING)\n");
+    printf("  -T, --rt-tune        Tune C-states, governor, NIC IRQ affinity and coalescing (restored on exit)\n");
+    printf("  -D, --dc-steer       Steer the DC reference clock from the host clock\n");
+    printf("  -h, --help           Show this help\n");
+}
 
 int main(int argc, char *argv[])
 {
@@ -171,11 +488,159 @@ int main(int argc, char *argv[])
     int motor_enabled = 0;
     int32 start_position = 0;
 
+    static const struct option long_options[] = {
+        { "xdp",       no_argument,       NULL, 'x' },
+        { "xdp-copy",  no_argument,       NULL, 'c' },
+        { "xdp-queue", required_argument, NULL, 'q' },
+        { "busy-poll", optional_argument, NULL, 'b' },
+        { "rx-budget", required_argument, NULL, 'r' },
+        { "pipeline",  no_argument,       NULL, 'p' },
+        { "redundant", required_argument, NULL, 'R' },
+        { "hotplug",   no_argument,       NULL, 'H' },
+        { "huge-pages", no_argument,      NULL, 'G' },
+        { "slow",      required_argument, NULL, 'S' },
+        { "slow-div",  required_argument, NULL, 'd' },
+        { "pack-frames", no_argument,     NULL, 'F' },
+        { "config",    required_argument, NULL, 'C' },
+        { "shm",       required_argument, NULL, 'M' },
+        { "estop-broadcast", no_argument, NULL, 'E' },
+        { "launch-offset", required_argument, NULL, 'L' },
+        { "timestamps", no_argument,      NULL, 't' },
+        { "rt-tune",   no_argument,       NULL, 'T' },
+        { "dc-steer",  no_argument,       NULL, 'D' },
+        { "help",      no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "xcq:b::r:pR:HGS:d:FC:M:EL:tTDh", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'x':
+            use_xdp = 1;
+            break;
+        case 'c':
+            use_xdp = 1;
+            xdp_force_copy = 1;
+            break;
+        case 'q':
+            xdp_queue = atoi(optarg);
+            break;
+        case 'b':
+            busy_poll_us = optarg ? atoi(optarg) : 50;
+            if (busy_poll_us <= 0)
+                busy_poll_us = 50;
+            break;
+        case 'r':
+            rx_budget_us = atoi(optarg);
+            if (rx_budget_us <= 0)
+            {
+                printf("Receive budget must be at least 1 us\n");
+                return 1;
+            }
+            break;
+        case 'p':
+            pipeline = 1;
+            break;
+        case 'R':
+            ifname_red = optarg;
+            break;
+        case 'H':
+            hotplug = 1;
+            break;
+        case 'G':
+            io_map_flags |= PROCESS_IMAGE_HUGE_PAGES;
+            break;
+        case 'S':
+            slow_slaves = optarg;
+            break;
+        case 'F':
+            pack_frames = 1;
+            break;
+        case 'C':
+            config_file = optarg;
+            break;
+        case 'M':
+            shm_name = optarg;
+            break;
+        case 'E':
+            estop_broadcast = 1;
+            break;
+        case 'L':
+            launch_offset_ns = (int64_t)atoi(optarg) * 1000;
+            if (launch_offset_ns <= 0)
+            {
+                printf("Launch offset must be at least 1 us\n");
+                return 1;
+            }
+            break;
+        case 't':
+            timestamps = 1;
+            break;
+        case 'T':
+            rt_tune = 1;
+            break;
+        case 'D':
+            dc_steer = 1;
+            break;
+        case 'd':
+            slow_divider = atoi(optarg);
+            if (slow_divider < 1)
+            {
+                printf("Slow group divider must be at least 1\n");
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    // Settings: built-in defaults or the configuration file, validated up front
+    if (!config_load(config_file))
+    {
+        printf("Invalid configuration%s%s\n", config_file ? " in " : "", config_file ? config_file : "");
+        return 1;
+    }
+    const config_rt *cfg = config_get();
+    const config_params *params = config_params_acquire();
+    cycle_time_ns = cfg->cycle_ns;
+    motor_slave = cfg->axis[0].slave;
+
+    if (rx_budget_us == 0)
+        rx_budget_us = cycle_time_ns / 2000;
+    if (rx_budget_us * 1000 >= (int)cycle_time_ns)
+    {
+        printf("Receive budget must be between 1 and %u us\n", cycle_time_ns / 1000 - 1);
+        return 1;
+    }
+    if (launch_offset_ns >= (int64_t)rx_budget_us * 1000)
+    {
+        printf("Launch offset must be below the receive budget (%d us)\n", rx_budget_us);
+        return 1;
+    }
+
     // Setup signal handler
     signal(SIGINT, signal_handler);
+    signal(SIGHUP, signal_handler);
+    signal(SIGQUIT, signal_handler);
+    signal(SIGUSR1, signal_handler);
 
     // Auto-detect or use specified interface
-    if (argc < 2)
+    if (optind >= argc && ifname_red != NULL)
+    {
+        printf("Redundant mode needs the primary interface: %s -R %s <interface>\n", argv[0], ifname_red);
+        return 1;
+    }
+
+    if (optind >= argc && cfg->interface[0] != '\0')
+    {
+        ifname = (char *)cfg->interface;
+        printf("Using configured interface: %s\n", ifname);
+    }
+    else if (optind >= argc)
     {
         // No interface specified - auto-detect
         printf("No interface specified, auto-detecting...\n\n");
@@ -197,20 +662,51 @@ int main(int argc, char *argv[])
     else
     {
         // Use specified interface
-        ifname = argv[1];
+        ifname = argv[optind];
         printf("Using specified interface: %s\n", ifname);
     }
 
+    axis_units_init(&motor_units, cfg->axis[0].counts_per_rev, cfg->axis[0].gear_ratio,
+                    cfg->axis[0].rated_torque_mnm);
+
     printf("MyActuator Motor Control - SOEM\n");
     printf("================================\n");
     printf("Network interface: %s\n", ifname);
-    printf("Target: %d RPM (%d pulses/s)\n", TARGET_RPM, TARGET_VELOCITY);
+    if (ifname_red != NULL)
+        printf("Redundant interface: %s\n", ifname_red);
+    printf("Target: %.1f RPM (%.3f rad/s, %d pulses/s)\n", params->axis[0].target_rpm,
+           params->axis[0].target_rpm * RPM_TO_RADS, params->axis[0].target_velocity);
+    printf("Cycle: %u us%s%s\n", cycle_time_ns / 1000, config_file ? " | Config: " : "",
+           config_file ? config_file : "");
     printf("================================\n\n");
 
+    // Host jitter sources, checked (and with -T fixed) before any slave traffic
+    rt_preflight_run(ifname, cfg->cpu, rt_tune);
+    if (rt_tune)
+        atexit(rt_preflight_restore);
+
     // Initialize SOEM
-    if (ec_init(ifname))
+    int init_ok = (ifname_red != NULL) ? ec_init_redundant(ifname, ifname_red) : ec_init(ifname);
+    if (init_ok)
     {
-        printf("✓ SOEM initialized on %s\n", ifname);
+        if (ifname_red != NULL)
+            printf("✓ SOEM initialized on %s + %s (redundant ring)\n", ifname, ifname_red);
+        else
+            printf("✓ SOEM initialized on %s\n", ifname);
+
+        // Switch frame exchange to AF_XDP before any slave traffic
+        if (use_xdp)
+        {
+            if (!ec_link_open_xdp(ifname, xdp_queue, xdp_force_copy))
+            {
+                printf("Failed to open AF_XDP socket on %s queue %d\n", ifname, xdp_queue);
+                ec_close();
+                return 1;
+            }
+        }
+        if (busy_poll_us > 0 && !ec_link_set_busy_poll(busy_poll_us))
+            printf("  Warning: busy-poll receive not enabled\n");
+        printf("✓ Link layer: %s\n", ec_link_name());
 
         // Find and configure slaves
         if (ec_config_init(FALSE) > 0)
@@ -221,23 +717,80 @@ int main(int argc, char *argv[])
             if (slave_count == 0)
             {
                 printf("No slaves found!\n");
+                ec_link_close();
                 ec_close();
                 return 1;
             }
 
-            printf("✓ Motor: %s\n", ec_slave[1].name);
+            if (motor_slave > ec_slavecount)
+            {
+                printf("Motor slave %u not found (%d slave(s))\n", motor_slave, ec_slavecount);
+                ec_link_close();
+                ec_close();
+                return 1;
+            }
+            printf("✓ Motor: %s (slave %u)\n", ec_slave[motor_slave].name, motor_slave);
 
             // Configure Distributed Clock with 2ms cycle (2,000,000 ns)
             ec_configdc();
             printf("✓ DC configured\n");
 
-            // Map PDO
-            ec_config_map(&io_map);
-            printf("✓ PDO mapped\n");
+            // Pull the slave clocks onto the reference before SYNC0 starts
+            dc_clock_converge_report dcr;
+            if (dc_clock_converge(DC_CONVERGE_DATAGRAMS, DC_CONVERGE_TARGET_NS, &dcr) && dcr.clocks > 0)
+                printf("✓ DC clocks converged: %d clock(s) within %lld ns after %d ARMW (%.1f ms)\n",
+                       dcr.clocks, (long long)dcr.diff_max_ns, dcr.datagrams, dcr.elapsed_ns / 1e6);
+            else if (dcr.clocks > 0 && dcr.diff_max_ns < 0)
+                printf("  Warning: DC clocks not converged: a clock did not answer (%d ARMW)\n", dcr.datagrams);
+            else if (dcr.clocks > 0)
+                printf("  Warning: DC clocks not converged: max difference %lld ns after %d ARMW\n",
+                       (long long)dcr.diff_max_ns, dcr.datagrams);
+
+            // Slow slaves get their own group, frame and process image
+            if (slow_slaves != NULL)
+            {
+                if (pd_group_assign(SLOW_GROUP, slow_slaves, slow_divider) < 0 || ec_slave[motor_slave].group != 0)
+                {
+                    printf("Invalid slow slave list \"%s\" (1..%d, motor must stay in the fast frame)\n",
+                           slow_slaves, ec_slavecount);
+                    ec_link_close();
+                    ec_close();
+                    return 1;
+                }
+            }
+
+            // Map PDO into a process image sized from the mapping
+            if (!process_image_map(&io_map, 0, io_map_flags) ||
+                !pd_group_map(io_map_flags, WKC_MISS_THRESHOLD))
+            {
+                ec_link_close();
+                ec_close();
+                return 1;
+            }
+            printf("✓ PDO mapped (%zu bytes, %zu allocated%s, %d frame(s))\n",
+                   io_map.used, io_map.size, io_map.huge ? ", huge page" : "", ec_group[0].nsegments);
+            if (pack_frames && frame_layout_optimize(0, &io_map) < 0)
+            {
+                ec_link_close();
+                ec_close();
+                return 1;
+            }
+            if (pipeline && !process_image_alloc(&pipeline_outputs, io_map.used, 0))
+            {
+                printf("✗ Pipelined cycle: cannot allocate the output buffer\n");
+                ec_link_close();
+                ec_close();
+                return 1;
+            }
+            topology_init(&io_map, io_map_flags, cycle_time_ns, setup_slave);
 
-            // Configure DC sync on slave 1 with 2ms cycle
-            ec_dcsync0(1, TRUE, 2000000U, 0);
-            printf("✓ DC sync activated (2ms cycle)\n");
+            // Configure DC sync on the motor with the cycle time
+            ec_dcsync0(motor_slave, TRUE, cycle_time_ns, 0);
+            printf("✓ DC sync activated (%u us cycle)\n", cycle_time_ns / 1000);
+            if (!dc_clock_init(cycle_time_ns, 0))
+                printf("  Warning: no DC reference clock, inputs carry no DC time\n");
+            else if (dc_steer && dc_clock_steer_enable())
+                printf("✓ DC reference clock steered from the host clock\n");
 
             // Wait for all slaves to reach SAFE-OP
             ec_statecheck(0, EC_STATE_SAFE_OP, EC_TIMEOUTSTATE * 4);
@@ -245,26 +798,26 @@ int main(int argc, char *argv[])
             printf("✓ SAFE-OP state\n");
 
             // Get PDO pointers
-            output_pdo = (OutputPDO *)(ec_slave[1].outputs);
-            input_pdo = (InputPDO *)(ec_slave[1].inputs);
+            output_pdo = (OutputPDO *)(ec_slave[motor_slave].outputs);
+            input_pdo = (InputPDO *)(ec_slave[motor_slave].inputs);
 
             // Initialize output PDO
             memset(output_pdo, 0, sizeof(OutputPDO));
-            output_pdo->mode = 9;           // CSV mode
-            output_pdo->max_torque = 1000;  // Max torque
+            output_pdo->mode = cfg->axis[0].mode;
+            output_pdo->max_torque = params->axis[0].max_torque;
 
-            // Set interpolation time period (0x60C2:01) to 2ms
             printf("\nSetting interpolation period...\n");
-            int8 interp_period = 2;  // 2ms
-            int wkc_sdo = ec_SDOwrite(1, 0x60C2, 0x01, FALSE, sizeof(interp_period), &interp_period, EC_TIMEOUTRXM);
-            if (wkc_sdo > 0)
-                printf("  ✓ Interpolation period set to %d ms\n", interp_period);
-            else
-                printf("  Warning: Could not set interpolation period\n");
+            setup_slave(motor_slave);
+
+            if (axis_units_read_rated_torque(&motor_units, motor_slave))
+                printf("  ✓ Rated torque (0x6076): %u mNm\n", motor_units.rated_torque_mnm);
+            else if (motor_units.rated_torque_mnm == 0)
+                printf("  Warning: rated torque (0x6076) not readable\n");
 
             // Send initial PDO
             ec_send_processdata();
             wkc = ec_receive_processdata(EC_TIMEOUTRET);
+            pd_group_exchange_all(EC_TIMEOUTRET);
 
             // Transition to OP state
             ec_slave[0].state = EC_STATE_OPERATIONAL;
@@ -276,6 +829,7 @@ int main(int argc, char *argv[])
             {
                 ec_send_processdata();
                 ec_receive_processdata(EC_TIMEOUTRET);
+                pd_group_exchange_all(EC_TIMEOUTRET);
                 ec_statecheck(0, EC_STATE_OPERATIONAL, 50000);
                 wait_count++;
             }
@@ -285,9 +839,45 @@ int main(int argc, char *argv[])
             {
                 printf("✓ OP state\n\n");
 
+                // Launch times and frame stamps only once the configuration
+                // traffic is done and before any other thread sends
+                if (launch_offset_ns > 0)
+                {
+                    int mode = ec_link_enable_launch_time(ifname);
+                    if (mode == EC_LINK_LAUNCH_OFF)
+                    {
+                        printf("  Warning: launch-time scheduling not enabled, frames leave when sent\n");
+                        launch_offset_ns = 0;
+                    }
+                    else
+                    {
+                        printf("✓ Launch time: %lld us after cycle start (%s)\n",
+                               (long long)(launch_offset_ns / 1000),
+                               mode == EC_LINK_LAUNCH_TXTIME ? "SO_TXTIME, ETF qdisc" : "software spin");
+                    }
+                }
+                if (timestamps)
+                {
+                    int mode = ec_link_enable_timestamping(ifname);
+                    if (mode == EC_LINK_TS_OFF)
+                        printf("  Warning: frame timestamping not enabled\n");
+                    else
+                        printf("✓ Frame timestamps: %s\n",
+                               mode == EC_LINK_TS_HARDWARE ? "hardware (NIC)" : "software (driver)");
+                }
+
                 expected_wkc = (ec_group[0].outputsWKC * 2) + ec_group[0].inputsWKC;
                 printf("Expected WKC: %d\n", expected_wkc);
 
+                if (!wkc_monitor_start(expected_wkc, WKC_MISS_THRESHOLD))
+                    printf("  Warning: WKC diagnostics thread not started\n");
+                if (!supervisor_start(SUPERVISOR_PERIOD_US, SUPERVISOR_MAX_TRIES,
+                                      hotplug ? TOPOLOGY_SCAN_US : 0))
+                    printf("  Warning: slave supervisor thread not started\n");
+                int dc_clocks = dc_monitor_start(DC_SYNC_THRESHOLD_NS);
+                if (dc_clocks > 0)
+                    printf("✓ DC sync monitor: %d clock(s), one 0x092C read per cycle\n", dc_clocks);
+
                 printf("\n");
                 printf("================================\n");
                 printf("REACTIVE STATE MACHINE\n");
@@ -297,23 +887,223 @@ int main(int argc, char *argv[])
                 printf("Status 0x1237 → Send velocity\n");
                 printf("================================\n\n");
 
-                // Main cyclic loop
-                struct timespec sleep_time;
-                sleep_time.tv_sec = 0;
-                sleep_time.tv_nsec = 2000000;  // 2ms
+                if (pipeline)
+                {
+                    printf("Pipelined cycle: outputs computed in cycle N are sent at the\n");
+                    printf("start of cycle N+1 (input-to-output latency: 2 cycles)\n\n");
+                }
+
+                // Shared memory for an external controller: the layout is complete
+                // before clients can see it
+                if (shm_name != NULL)
+                {
+                    shm = shm_io_create(shm_name, 1, cycle_time_ns);
+                    if (shm != NULL)
+                    {
+                        shm_io_axis *axis = shm_io_axis_at(shm, 0);
+                        axis->slave = motor_slave;
+                        axis->counts_per_rev = motor_units.counts_per_rev;
+                        axis->rad_per_count = motor_units.rad_per_count;
+                        axis->rads_per_cps = motor_units.rads_per_cps;
+                        axis->nm_per_unit = motor_units.nm_per_unit;
+                        shm_io_publish(shm);
+                        printf("✓ Shared memory: /dev/shm%s (layout v%d, %u B per axis)\n\n",
+                               shm_name, SHM_IO_VERSION, shm->axis_size);
+                    }
+                    else
+                    {
+                        printf("  Warning: shared memory %s not created, using configured targets\n\n",
+                               shm_name);
+                    }
+                }
+                if (estop_broadcast)
+                    prepare_estop_broadcast(output_pdo);
+
+                shm_io_command shm_cmd = { 0 };
+                uint32_t shm_cmd_seq = 0;
+                setpoint_watchdog setpoint_wd = { 0 };
+                int quick_stopped = 0;
+
+                // Main cyclic loop on an absolute time grid
+                cycle_sched sched;
+                if (!config_reload_start())
+                    printf("  Warning: configuration reload thread not started\n");
+
+                cycle_set_rt(cfg->cpu, cfg->rt_priority);
+                cycle_init(&sched, cycle_time_ns, (int64_t)rx_budget_us * 1000);
+                int64_t rx_max_ns = 0;
+                int in_flight = 0;
+                int line_break = 0;
 
                 while (run_flag)
                 {
-                    // Send process data
-                    ec_send_processdata();
+                    // Sleep until the next cycle boundary
+                    cycle_wait(&sched);
+
+                    // Tunables reloaded since the last cycle take effect here
+                    params = config_params_acquire();
+
+                    // E-stop: one atomic load; once latched the quick stop rides in this
+                    // cycle's frame, whatever was computed before
+                    int estop = estop_poll(shm);
+                    if (estop)
+                    {
+                        estop_broadcast_send();
+                        quick_stop_all();
+                        output_pdo->control_word = 0x0B;
+                        output_pdo->target_velocity = 0;
+                    }
+
+                    int64_t rx_start_ns = cycle_now_ns();
+                    int received = 1;
+                    dc_stamp dc = { 0 };     // DC time of the frame the inputs came with
+                    if (pipeline)
+                    {
+                        // Collect the frame sent one cycle ago (normally already back),
+                        // then put the outputs computed last cycle on the wire at once.
+                        // The inputs processed below are therefore one cycle old, and
+                        // the outputs computed below leave with the next cycle's frame.
+                        if (in_flight)
+                        {
+                            wkc = receive_pipelined(cycle_rx_timeout_us(&sched));
+                            frame_layout_received();
+                            dc_clock_stamp(&dc);
+                            dc_monitor_collect();
+                        }
+                        else
+                        {
+                            received = 0;
+                        }
+                        // Slow frames cannot share the wire with the one in flight
+                        pd_group_cycle(cycle_count, cycle_rx_timeout_us(&sched));
+                        if (topology_apply_pending())
+                        {
+                            output_pdo = (OutputPDO *)(ec_slave[motor_slave].outputs);
+                            input_pdo = (InputPDO *)(ec_slave[motor_slave].inputs);
+                        }
+                        // The frame about to leave is the one estop_frame_sent() stamps;
+                        // write the quick stop into it right before it goes
+                        if (estop)
+                        {
+                            quick_stop_all();
+                            output_pdo->control_word = 0x0B;
+                            output_pdo->target_velocity = 0;
+                        }
+                        send_processdata(&sched);
+                        frame_layout_sent();
+                        if (estop)
+                            estop_frame_sent(ec_link_last_tx_ns());
+                        in_flight = 1;
+                    }
+                    else
+                    {
+                        // Swap in a grown process image between two frames
+                        if (topology_apply_pending())
+                        {
+                            output_pdo = (OutputPDO *)(ec_slave[motor_slave].outputs);
+                            input_pdo = (InputPDO *)(ec_slave[motor_slave].inputs);
+                        }
+
+                        // Send process data (all frames back to back)
+                        send_processdata(&sched);
+                        frame_layout_sent();
+                        if (estop)
+                            estop_frame_sent(ec_link_last_tx_ns());
+
+                        // Receive process data, never waiting past the receive deadline
+                        wkc = ec_receive_processdata(cycle_rx_timeout_us(&sched));
+                        frame_layout_received();
+                        dc_clock_stamp(&dc);
+                        dc_monitor_collect();
+                    }
+
+                    if (estop)
+                        estop_broadcast_collect(cycle_rx_timeout_us(&sched));
+
+                    // A short working counter also asks the supervisor to check slave states
+                    if (received && wkc_monitor_check(wkc) > 0)
+                        ec_group[0].docheckstate = TRUE;
+
+                    int64_t rx_ns = cycle_now_ns() - rx_start_ns;
+                    if (rx_ns > rx_max_ns)
+                        rx_max_ns = rx_ns;
+
+                    // Feedback out, latest external setpoint in
+                    if (shm != NULL)
+                    {
+                        shm_io_feedback *fb = shm_io_feedback_begin(shm, 0);
+                        fb->cycle = cycle_count;
+                        fb->time_ns = rx_start_ns + rx_ns;
+                        fb->actual_position = input_pdo->actual_position;
+                        fb->actual_velocity = input_pdo->actual_velocity;
+                        fb->actual_torque = input_pdo->actual_torque;
+                        fb->status_word = input_pdo->status_word;
+                        fb->error_code = input_pdo->error_code;
+                        fb->mode_display = input_pdo->mode_display;
+                        fb->operational = received && supervisor_slave_operational(motor_slave);
+                        fb->wkc = wkc;
+                        fb->dc_frame_ns = dc.frame_ns;
+                        fb->dc_sample_ns = dc.sample_ns;
+                        shm_io_feedback_end(shm, 0);
+                        shm_io_cycle_done(shm, rx_start_ns + rx_ns);
+
+                        shm_io_get_command(shm, 0, &shm_cmd, &shm_cmd_seq);
+                    }
 
-                    // Receive process data
-                    wkc = ec_receive_processdata(EC_TIMEOUTRET);
+                    // An external setpoint that stopped changing is not trusted for long
+                    int setpoint_stale = 0;
+                    if (shm_cmd.flags & SHM_IO_CMD_VALID)
+                        setpoint_stale = setpoint_watchdog_check(&setpoint_wd, shm_cmd_seq, sched.start_ns,
+                                                                 params->setpoint_timeout_ns);
+                    else
+                        setpoint_watchdog_reset(&setpoint_wd);
+
+                    // Redundant ring: the frame still reaches every slave after a
+                    // break, SOEM just routes it back through the second port
+                    if (ifname_red != NULL && ec_link_line_break() != line_break)
+                    {
+                        line_break = !line_break;
+                        if (line_break)
+                            printf("\n⚠ Line break detected at cycle %d (WKC %d/%d), running on both ports\n",
+                                   cycle_count, wkc, topology_expected_wkc());
+                        else
+                            printf("\n✓ Ring restored at cycle %d\n", cycle_count);
+                    }
 
                     // Reactive state machine (like IgH example)
                     uint16 status = input_pdo->status_word;
 
-                    if (status == 0x1208)  // Fault
+                    if (estop)
+                    {
+                        // Latched: hold the quick stop until exit
+                        output_pdo->control_word = 0x0B;
+                        output_pdo->target_velocity = 0;
+
+                        estop_state es;
+                        estop_get_state(&es);
+                        if (es.drive_ns == 0 && (status & 0x006F) != 0x0027)
+                        {
+                            estop_drive_stopped(cycle_now_ns());
+                            printf("🛑 E-STOP: quick stop in frame %lld us after trigger, "
+                                   "drive left Operation Enabled after %lld us (status 0x%04X)\n",
+                                   (long long)((es.frame_ns - es.trigger_ns) / 1000),
+                                   (long long)((cycle_now_ns() - es.trigger_ns) / 1000), status);
+                        }
+                        motor_enabled = motor_enabled && (status & 0x0004);
+                    }
+                    else if (!supervisor_slave_operational(motor_slave))
+                    {
+                        // Inputs are stale while the drive is being recovered; hold a
+                        // safe command and re-run the enable sequence once it is back
+                        output_pdo->control_word = 0;
+                        output_pdo->target_velocity = 0;
+                        if (motor_enabled)
+                        {
+                            motor_enabled = 0;
+                            printf("\n⚠ Motor out of OP, holding zero command until recovered\n");
+                        }
+                    }
+                    else if (status == 0x1208)  // Fault
                     {
                         output_pdo->control_word = 0x80;  // Fault reset
                         output_pdo->target_velocity = 0;
@@ -333,10 +1123,50 @@ int main(int argc, char *argv[])
                         output_pdo->control_word = 0x0F;  // Enable operation
                         output_pdo->target_velocity = 0;
                     }
+                    else if ((status & 0x006F) == 0x0007)  // Quick stop active
+                    {
+                        // Stays here (0x605A = 6) until setpoints are fresh again
+                        output_pdo->target_velocity = 0;
+                        if (setpoint_stale)
+                        {
+                            output_pdo->control_word = 0x0B;  // Hold quick stop
+                        }
+                        else
+                        {
+                            output_pdo->control_word = 0x0F;  // Enable operation
+                            if (quick_stopped)
+                            {
+                                quick_stopped = 0;
+                                printf("\n✓ Setpoint fresh again, resuming from quick stop\n");
+                            }
+                        }
+                    }
+                    else if ((status == 0x1237 || status == 0x1637) && setpoint_stale)
+                    {
+                        output_pdo->control_word = 0x0B;  // Quick stop, drive ramps down
+                        output_pdo->target_velocity = 0;
+                        if (!quick_stopped)
+                        {
+                            quick_stopped = 1;
+                            printf("\n⚠ Setpoint stale for %lld us, quick stop (trip %llu)\n",
+                                   (long long)((sched.start_ns - setpoint_wd.fresh_ns) / 1000),
+                                   (unsigned long long)setpoint_wd.trips);
+                        }
+                    }
                     else if (status == 0x1237 || status == 0x1637)  // Operation enabled
                     {
                         output_pdo->control_word = 0x0F;  // Keep enabled
-                        output_pdo->target_velocity = TARGET_VELOCITY;  // 10 RPM
+                        int32 velocity = params->axis[0].target_velocity;
+                        if (shm_cmd.flags & SHM_IO_CMD_VALID)
+                        {
+                            int32 limit = params->axis[0].max_velocity;
+                            velocity = shm_cmd.target_velocity;
+                            if (velocity > limit)
+                                velocity = limit;
+                            else if (velocity < -limit)
+                                velocity = -limit;
+                        }
+                        output_pdo->target_velocity = velocity;
 
                         if (!motor_enabled)
                         {
@@ -348,21 +1178,27 @@ int main(int argc, char *argv[])
                     }
 
                     // Always maintain mode and max torque
-                    output_pdo->mode = 9;           // CSV mode
-                    output_pdo->max_torque = 1000;  // Max torque
+                    output_pdo->mode = cfg->axis[0].mode;
+                    output_pdo->max_torque = params->axis[0].max_torque;
+
+                    // Slow frames go out once the fast outputs are ready
+                    if (!pipeline)
+                        pd_group_cycle(cycle_count, cycle_left_us(&sched));
 
                     cycle_count++;
 
-                    // Print status every 500 cycles (~1 second at 2ms/cycle)
-                    if (cycle_count % 500 == 0)
+                    // Print status every status_ms (default ~1 second)
+                    if (cycle_count % params->status_cycles == 0)
                     {
-                        double actual_rpm = (input_pdo->actual_velocity * 60.0) / 131072.0;
+                        double actual_rpm = axis_units_vel_to_rads(&motor_units, input_pdo->actual_velocity) * RADS_TO_RPM;
                         int32 pos_delta = input_pdo->actual_position - start_position;
+                        wkc_stats wkc_now;
+                        wkc_monitor_get_stats(&wkc_now);
 
                         printf("[%6d] Status: 0x%04X | Control: 0x%02X | "
                                "Pos: %10d (Δ%+10d) | "
                                "Vel: %7.2f RPM (%6d p/s) | "
-                               "Mode: %d | WKC: %d/%d\n",
+                               "Mode: %d | WKC: %d/%d (misses %llu) | RX max: %lld us\n",
                                cycle_count,
                                input_pdo->status_word,
                                output_pdo->control_word,
@@ -372,31 +1208,321 @@ int main(int argc, char *argv[])
                                input_pdo->actual_velocity,
                                input_pdo->mode_display,
                                wkc,
-                               expected_wkc);
+                               topology_expected_wkc(),
+                               (unsigned long long)wkc_now.misses,
+                               (long long)(rx_max_ns / 1000));
+                        rx_max_ns = 0;
+
+                        if (ifname_red != NULL)
+                        {
+                            ec_link_red_stats red;
+                            ec_link_get_red_stats(&red);
+                            printf("         Ring: %s | Breaks: %llu | Broken frames: %llu/%llu | Lost: %llu | "
+                                   "RX intact %lld us, broken %lld us (max %lld)\n",
+                                   red.line_break ? "BROKEN" : "OK",
+                                   (unsigned long long)red.breaks,
+                                   (unsigned long long)red.broken_frames,
+                                   (unsigned long long)red.frames,
+                                   (unsigned long long)red.lost_frames,
+                                   (long long)(red.intact_rx_ns / 1000),
+                                   (long long)(red.broken_rx_ns / 1000),
+                                   (long long)(red.broken_rx_max_ns / 1000));
+                        }
+
+                        frame_layout_stats frames[FRAME_LAYOUT_MAX_FRAMES];
+                        int nframes = frame_layout_get_stats(frames, FRAME_LAYOUT_MAX_FRAMES);
+                        if (nframes > 1)
+                        {
+                            printf("         Frames (RTT avg/max):");
+                            for (int f = 0; f < nframes; f++)
+                                printf(" [%d] %u B %lld/%lld us%s", f, frames[f].bytes,
+                                       (long long)(frames[f].samples ? frames[f].rtt_sum_ns / (int64_t)frames[f].samples / 1000 : 0),
+                                       (long long)(frames[f].rtt_max_ns / 1000),
+                                       f + 1 < nframes ? " |" : "\n");
+                        }
+
+                        if (ec_link_timestamping() != EC_LINK_TS_OFF)
+                        {
+                            // Frames overlap on the wire; the slowest frame bounds the cycle
+                            frame_layout_stats rt = { 0 };
+                            for (int f = 0; f < nframes; f++)
+                            {
+                                rt.wire_samples += frames[f].wire_samples;
+                                rt.wire_rtt_sum_ns += frames[f].wire_rtt_sum_ns;
+                                rt.host_sum_ns += frames[f].host_sum_ns;
+                                if (frames[f].wire_rtt_max_ns > rt.wire_rtt_max_ns)
+                                    rt.wire_rtt_max_ns = frames[f].wire_rtt_max_ns;
+                                if (frames[f].host_max_ns > rt.host_max_ns)
+                                    rt.host_max_ns = frames[f].host_max_ns;
+                            }
+                            int64_t n = rt.wire_samples ? (int64_t)rt.wire_samples : 1;
+                            printf("         RTT (%s stamps): wire avg %lld / max %lld us | "
+                                   "host avg %lld / max %lld us\n",
+                                   ec_link_timestamping() == EC_LINK_TS_HARDWARE ? "NIC" : "driver",
+                                   (long long)(rt.wire_rtt_sum_ns / n / 1000),
+                                   (long long)(rt.wire_rtt_max_ns / 1000),
+                                   (long long)(rt.host_sum_ns / n / 1000),
+                                   (long long)(rt.host_max_ns / 1000));
+                        }
+
+                        dc_monitor_stats dcm;
+                        dc_monitor_get_stats(&dcm);
+                        if (dcm.samples > 0)
+                            printf("         DC sync: worst %d ns (slave %d) | %d over %d ns | %u events%s\n",
+                                   dcm.worst_ns, dcm.worst_slave, dcm.over, DC_SYNC_THRESHOLD_NS, dcm.events,
+                                   dcm.dropped ? " | readings dropped" : "");
+
+                        dc_clock_sync_stats sync;
+                        dc_clock_get_sync_stats(&sync);
+                        if (sync.locked)
+                            printf("         DC %s host: offset %+.3f s | drift %+.2f ppm | "
+                                   "error %+lld ns, max %lld ns | %llu outliers, %llu relocks\n",
+                                   sync.steering ? "steered by" : "vs",
+                                   sync.offset_ns / 1e9, sync.drift_ppm,
+                                   (long long)sync.error_ns, (long long)sync.error_max_ns,
+                                   (unsigned long long)sync.outliers, (unsigned long long)sync.relocks);
+
+                        if (shm != NULL)
+                        {
+                            shm_io_wake_stats wake;
+                            shm_io_get_wake_stats(shm, &wake);
+                            if (wake.wakeups > 0)
+                                printf("         Shared memory: %u waiting | %llu wakeups | "
+                                       "wake latency avg %lld us, max %lld us\n",
+                                       wake.waiters, (unsigned long long)wake.wakeups,
+                                       (long long)(wake.latency_avg_ns / 1000),
+                                       (long long)(wake.latency_max_ns / 1000));
+                        }
+
+                        if (setpoint_wd.active)
+                            printf("         Setpoint: age %lld us | longest gap %lld us | "
+                                   "stale trips %llu%s\n",
+                                   (long long)((sched.start_ns - setpoint_wd.fresh_ns) / 1000),
+                                   (long long)(setpoint_wd.max_interval_ns / 1000),
+                                   (unsigned long long)setpoint_wd.trips,
+                                   setpoint_wd.tripped ? " (STALE)" : "");
+
+                        if (pd_group_count() > 0)
+                        {
+                            pd_group_stats slow;
+                            pd_group_get_stats(SLOW_GROUP, &slow);
+                            printf("         Slow group: %d slave(s) every %d cycles | WKC: %d/%d "
+                                   "(misses %llu) | RX max: %lld us\n",
+                                   slow.slaves, slow.divider, slow.last_wkc, slow.expected_wkc,
+                                   (unsigned long long)slow.misses,
+                                   (long long)(slow.rx_max_ns / 1000));
+                        }
 
                         if (abs(pos_delta) > 1000)
                         {
                             printf("         🎉 MOTOR IS MOVING! Moved %d counts!\n", pos_delta);
                         }
                     }
+                }
+
+                config_reload_stop();
+                supervisor_stop();
+                wkc_monitor_stop();
+
+                // Drain the pipelined frame so the stop sequence starts with an empty stack
+                if (in_flight)
+                {
+                    receive_pipelined(EC_TIMEOUTRET);
+                    dc_monitor_collect();
+                }
+                dc_monitor_stop();
+
+                // Controlled stop: bring the axis to standstill along the configured
+                // deceleration, then disable. Bounded by stop_timeout_ms.
+                const config_axis *stop_axis = &cfg->axis[0];
+                estop_state estop_report;
+                estop_get_state(&estop_report);
+                int quick = cfg->stop_mode == CONFIG_STOP_QUICK || estop_report.latched;
+                printf("\nStopping motor (%s, %.0f RPM/s)...\n",
+                       quick ? "quick stop" : "ramp", stop_axis->stop_decel_rpm_s);
+
+                int32 ramp_velocity = output_pdo->target_velocity;
+                int32 ramp_step = axis_units_rads_to_vel(&motor_units, stop_axis->stop_decel_rpm_s * RPM_TO_RADS *
+                                                         (cycle_time_ns / 1e9f));
+                if (ramp_step < 1)
+                    ramp_step = 1;
+                int32 standstill = axis_units_rads_to_vel(&motor_units, STANDSTILL_RPM * RPM_TO_RADS);
+                int32 stop_start_position = input_pdo->actual_position;
+                int32 stop_start_velocity = input_pdo->actual_velocity;
+                int64_t stop_start_ns = cycle_now_ns();
+                int64_t stop_deadline_ns = stop_start_ns + (int64_t)cfg->stop_timeout_ms * 1000000;
+                int64_t stop_ns = -1;
+                int still_cycles = 0;
+                int64_t still_since_ns = 0;
+
+                while (motor_enabled && cycle_now_ns() < stop_deadline_ns)
+                {
+                    if (quick)
+                    {
+                        output_pdo->control_word = 0x0B;  // Quick stop on the 0x6085 ramp
+                        output_pdo->target_velocity = 0;
+                        ramp_velocity = 0;
+                    }
+                    else
+                    {
+                        // Host-side profile: one deceleration step per cycle, still in CSV
+                        if (ramp_velocity > ramp_step)
+                            ramp_velocity -= ramp_step;
+                        else if (ramp_velocity < -ramp_step)
+                            ramp_velocity += ramp_step;
+                        else
+                            ramp_velocity = 0;
+                        output_pdo->control_word = 0x0F;
+                        output_pdo->target_velocity = ramp_velocity;
+                    }
+
+                    cycle_wait(&sched);
+                    send_processdata(&sched);
+                    wkc = ec_receive_processdata(cycle_rx_timeout_us(&sched));
+                    // Keep the slow group on its divider through the stop
+                    pd_group_cycle(cycle_count++, cycle_left_us(&sched));
+                    if (wkc <= 0)
+                        continue;
 
-                    // Sleep for 2ms cycle time
-                    nanosleep(&sleep_time, NULL);
+                    // Stop time is the first still cycle; the rest only confirm it
+                    if (ramp_velocity == 0 && abs(input_pdo->actual_velocity) <= standstill)
+                    {
+                        if (still_cycles++ == 0)
+                            still_since_ns = sched.start_ns;
+                    }
+                    else
+                    {
+                        still_cycles = 0;
+                    }
+                    if (still_cycles >= STANDSTILL_CYCLES)
+                    {
+                        stop_ns = still_since_ns - stop_start_ns;
+                        break;
+                    }
                 }
 
-                // Stop motor
-                printf("\nStopping motor...\n");
-                output_pdo->control_word = 0;
-                output_pdo->target_velocity = 0;
+                if (motor_enabled && stop_ns < 0)
+                    printf("⚠ No standstill after %u ms (%.2f RPM), disabling anyway\n", cfg->stop_timeout_ms,
+                           axis_units_vel_to_rads(&motor_units, input_pdo->actual_velocity) * RADS_TO_RPM);
 
+                // Disable: Shutdown from Operation Enabled, Disable Voltage from Quick Stop Active
+                output_pdo->control_word = quick ? 0x00 : 0x06;
+                output_pdo->target_velocity = 0;
                 for (int i = 0; i < 50; i++)
                 {
-                    ec_send_processdata();
-                    ec_receive_processdata(EC_TIMEOUTRET);
-                    nanosleep(&sleep_time, NULL);
+                    cycle_wait(&sched);
+                    send_processdata(&sched);
+                    wkc = ec_receive_processdata(cycle_rx_timeout_us(&sched));
+                    pd_group_cycle(cycle_count++, cycle_left_us(&sched));
+                    if (wkc > 0 && (input_pdo->status_word & 0x0004) == 0)
+                        break;
+                }
+
+                if (stop_ns >= 0)
+                {
+                    int32 distance = input_pdo->actual_position - stop_start_position;
+                    printf("✓ Motor stopped in %.1f ms from %.2f RPM | distance %d counts (%.4f rad)\n",
+                           stop_ns / 1e6,
+                           axis_units_vel_to_rads(&motor_units, stop_start_velocity) * RADS_TO_RPM,
+                           distance, axis_units_pos_to_rad(&motor_units, distance));
+                }
+                else
+                {
+                    printf("✓ Motor stopped\n");
+                }
+
+                if (estop_report.latched)
+                {
+                    static const char *sources[] = { "", "signal", "API", "shared memory" };
+                    printf("\nE-stop (%s): trigger → cycle %lld us | → frame %lld us | → drive ",
+                           sources[estop_report.source],
+                           (long long)((estop_report.seen_ns - estop_report.trigger_ns) / 1000),
+                           (long long)((estop_report.frame_ns - estop_report.trigger_ns) / 1000));
+                    estop_get_state(&estop_report);
+                    if (estop_report.drive_ns > 0)
+                        printf("%lld us\n", (long long)((estop_report.drive_ns - estop_report.trigger_ns) / 1000));
+                    else
+                        printf("not seen\n");
+                    if (estop_report.bcast_frames > 0)
+                        printf("  Broadcast: → frame %lld us | %llu frame(s) | last WKC %d/%d\n",
+                               (long long)((estop_report.bcast_ns - estop_report.trigger_ns) / 1000),
+                               (unsigned long long)estop_report.bcast_frames,
+                               estop_report.bcast_wkc, estop_report.bcast_expected);
+                }
+
+                if (sched.overruns > 0)
+                    printf("\nCycle overruns: %llu\n", (unsigned long long)sched.overruns);
+
+                if (launch_offset_ns > 0)
+                {
+                    ec_link_launch_stats launch;
+                    ec_link_get_launch_stats(&launch);
+                    printf("\nLaunch time: %llu cyclic frames, %llu late, %llu dropped by the qdisc, "
+                           "min lead %lld us\n",
+                           (unsigned long long)launch.frames, (unsigned long long)launch.late,
+                           (unsigned long long)launch.dropped, (long long)(launch.lead_min_ns / 1000));
+                }
+
+                wkc_stats wkc_summary;
+                wkc_monitor_get_stats(&wkc_summary);
+                if (wkc_summary.misses > 0)
+                    printf("\nWKC misses: %llu of %llu cycles | Longest run: %u | Anomalies: %llu\n",
+                           (unsigned long long)wkc_summary.misses,
+                           (unsigned long long)wkc_summary.cycles,
+                           wkc_summary.max_consecutive,
+                           (unsigned long long)wkc_summary.episodes);
+
+                for (int slave = 1; slave <= ec_slavecount; slave++)
+                {
+                    dc_monitor_slave_stats dcs;
+                    if (dc_monitor_get_slave_stats(slave, &dcs) && dcs.samples > 0)
+                        printf("DC sync slave %d: mean %lld ns | last %d ns | %u events | %llu missed\n",
+                               slave, (long long)(dcs.diff_abs_sum_ns / (int64_t)dcs.samples), dcs.diff_ns,
+                               dcs.events, (unsigned long long)dcs.missed);
                 }
 
-                printf("✓ Motor stopped\n");
+                supervisor_stats sup;
+                supervisor_get_stats(&sup);
+                if (sup.checks > 0)
+                    printf("Supervisor: %u checks | %u acks | %u OP requests | %u reconfigs | "
+                           "%u recoveries | %u lost | %u abandoned\n",
+                           sup.checks, sup.acks, sup.op_requests, sup.reconfigs,
+                           sup.recoveries, sup.lost, sup.given_up);
+
+                if (ifname_red != NULL)
+                {
+                    ec_link_red_stats red;
+                    ec_link_get_red_stats(&red);
+                    if (red.broken_frames > 0)
+                        printf("\nLine break penalty: +%lld us mean, %lld us worst receive time "
+                               "(%llu of %llu frames)\n",
+                               (long long)((red.broken_rx_ns - red.intact_rx_ns) / 1000),
+                               (long long)(red.broken_rx_max_ns / 1000),
+                               (unsigned long long)red.broken_frames,
+                               (unsigned long long)red.frames);
+                }
+
+
+                shm_io_wake_stats wake;
+                shm_io_get_wake_stats(shm, &wake);
+                if (wake.wakeups > 0)
+                {
+                    printf("\nClient wake latency (%llu wakeups, avg %lld us, max %lld us):\n",
+                           (unsigned long long)wake.wakeups,
+                           (long long)(wake.latency_avg_ns / 1000),
+                           (long long)(wake.latency_max_ns / 1000));
+                    for (int b = 0; b < SHM_IO_WAKE_BUCKETS; b++)
+                    {
+                        if (wake.histogram[b] == 0)
+                            continue;
+                        if (b < SHM_IO_WAKE_BUCKETS - 1)
+                            printf("  < %5d us: %llu\n", 1 << b, (unsigned long long)wake.histogram[b]);
+                        else
+                            printf("  >= %4d us: %llu\n", 1 << (b - 1), (unsigned long long)wake.histogram[b]);
+                    }
+                }
+                shm_io_destroy(shm);
+                shm = NULL;
             }
             else
             {
@@ -409,7 +1535,10 @@ int main(int argc, char *argv[])
         }
 
         // Close SOEM
+        ec_link_close();
         ec_close();
+        topology_release();
+        pd_group_release();
         printf("\n✓ SOEM closed\n");
     }
     else
@@ -0,0 +1,161 @@
+/**
+ * Secondary process-data groups
+ * See pd_group.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ethercat.h"
+#include "pd_group.h"
+#include "process_image.h"
+#include "cycle.h"
+
+typedef struct
+{
+    process_image img;
+    int           divider;
+    int           slaves;
+    int           expected_wkc;
+    int           consecutive;
+    int           mapped;
+    pd_group_stats stats;
+} pd_group;
+
+static pd_group groups[EC_MAXGROUP];
+static int miss_limit = 3;
+
+int pd_group_assign(uint8_t group, const char *slaves, int divider)
+{
+    if (group == 0 || group >= EC_MAXGROUP || divider < 1)
+        return -1;
+
+    int count = 0;
+    const char *p = slaves;
+    while (*p)
+    {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p)
+            return -1;
+        if (*end == '-')
+        {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p)
+                return -1;
+        }
+        if (first < 1 || last < first || last > ec_slavecount)
+            return -1;
+
+        for (long slave = first; slave <= last; slave++)
+        {
+            ec_slave[slave].group = group;
+            count++;
+        }
+
+        p = end;
+        if (*p == ',')
+            p++;
+        else if (*p)
+            return -1;
+    }
+
+    groups[group].divider = divider;
+    groups[group].slaves += count;
+    return count;
+}
+
+int pd_group_count(void)
+{
+    int n = 0;
+    for (int group = 1; group < EC_MAXGROUP; group++)
+        n += groups[group].mapped;
+    return n;
+}
+
+int pd_group_map(int flags, int miss_threshold)
+{
+    miss_limit = miss_threshold;
+
+    for (int group = 1; group < EC_MAXGROUP; group++)
+    {
+        pd_group *g = &groups[group];
+        if (g->slaves == 0)
+            continue;
+
+        if (!process_image_map(&g->img, group, flags))
+            return 0;
+
+        g->expected_wkc = (ec_group[group].outputsWKC * 2) + ec_group[group].inputsWKC;
+        g->mapped = 1;
+        memset(&g->stats, 0, sizeof(g->stats));
+        g->stats.expected_wkc = g->expected_wkc;
+        g->stats.slaves = g->slaves;
+        g->stats.divider = g->divider;
+
+        printf("✓ Group %d: %d slave(s), %zu bytes, every %d cycles, expected WKC %d\n",
+               group, g->slaves, g->img.used, g->divider, g->expected_wkc);
+    }
+    return 1;
+}
+
+static void exchange(uint8_t group, int timeout_us)
+{
+    pd_group *g = &groups[group];
+    int64_t t0 = cycle_now_ns();
+
+    ec_send_processdata_group(group);
+    int wkc = ec_receive_processdata_group(group, timeout_us);
+
+    int64_t rx_ns = cycle_now_ns() - t0;
+    if (rx_ns > g->stats.rx_max_ns)
+        g->stats.rx_max_ns = rx_ns;
+
+    g->stats.exchanges++;
+    g->stats.last_wkc = wkc;
+    if (wkc == g->expected_wkc)
+    {
+        g->consecutive = 0;
+        return;
+    }
+
+    g->stats.misses++;
+    if (++g->consecutive == miss_limit)
+        ec_group[group].docheckstate = TRUE;
+}
+
+void pd_group_cycle(uint64_t cycle, int timeout_us)
+{
+    for (int group = 1; group < EC_MAXGROUP; group++)
+    {
+        // Groups with the same rate are spread over different cycles
+        if (groups[group].mapped && (cycle + group) % groups[group].divider == 0)
+            exchange(group, timeout_us);
+    }
+}
+
+void pd_group_exchange_all(int timeout_us)
+{
+    for (int group = 1; group < EC_MAXGROUP; group++)
+    {
+        if (groups[group].mapped)
+            exchange(group, timeout_us);
+    }
+}
+
+void pd_group_get_stats(uint8_t group, pd_group_stats *out)
+{
+    *out = groups[group].stats;
+    groups[group].stats.rx_max_ns = 0;
+}
+
+void pd_group_release(void)
+{
+    for (int group = 1; group < EC_MAXGROUP; group++)
+    {
+        process_image_free(&groups[group].img);
+        groups[group].mapped = 0;
+    }
+}
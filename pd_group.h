@@ -0,0 +1,76 @@
+/**
+ * Secondary process-data groups with their own rates
+ *
+ * Slaves that do not need the fast loop (wrist/gripper drives, I/O
+ * terminals, ...) can be moved out of group 0 into SOEM groups
+ * 1..EC_MAXGROUP-1. Each group gets its own process image, its own LRW
+ * frame and its own expected working counter, and is exchanged only every
+ * `divider`-th cycle. Group 0's frame then carries only the critical
+ * axes, which keeps its size and round trip time down.
+ *
+ * The groups are exchanged by the cyclic task, after its own frame has
+ * come back, not by threads of their own. SOEM keeps one index stack for
+ * all groups: ec_receive_processdata_group() collects every frame sent
+ * since the last receive, whatever its group. Two groups in flight at
+ * once would mix their frames and working counters.
+ */
+
+#ifndef PD_GROUP_H
+#define PD_GROUP_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t exchanges;         // Frames exchanged
+    uint64_t misses;            // Exchanges with a wrong working counter
+    int      expected_wkc;
+    int      last_wkc;
+    int      slaves;            // Slaves assigned
+    int      divider;           // Exchanged every `divider` cycles
+    int64_t  rx_max_ns;         // Longest exchange since the last snapshot
+} pd_group_stats;
+
+/**
+ * Move slaves into `group`, exchanged every `divider` cycles
+ * `slaves` is a list like "3,5-7". Call after ec_config_init() and before
+ * mapping. Returns the number of slaves assigned, -1 on a bad list.
+ */
+int pd_group_assign(uint8_t group, const char *slaves, int divider);
+
+/**
+ * Map the process image of every group that has slaves
+ * `flags` as for process_image_map(). After `miss_threshold` consecutive
+ * wrong working counters the group asks the supervisor for a state check.
+ * Returns 1 on success (also when no group is in use).
+ */
+int pd_group_map(int flags, int miss_threshold);
+
+/**
+ * Number of groups in use besides group 0
+ */
+int pd_group_count(void);
+
+/**
+ * Exchange the groups due in `cycle`
+ * Called by the cyclic task once group 0's frame is back. Each frame may
+ * wait at most `timeout_us`.
+ */
+void pd_group_cycle(uint64_t cycle, int timeout_us);
+
+/**
+ * Exchange every group once, regardless of its rate (startup, shutdown)
+ */
+void pd_group_exchange_all(int timeout_us);
+
+/**
+ * Counters of `group`; resets its rx_max_ns
+ */
+void pd_group_get_stats(uint8_t group, pd_group_stats *stats);
+
+/**
+ * Free the groups' process images
+ */
+void pd_group_release(void);
+
+#endif
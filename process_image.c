@@ -0,0 +1,168 @@
+/**
+ * Process image allocation
+ * See process_image.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "ethercat.h"
+#include "process_image.h"
+
+#define HUGE_PAGE_SIZE  (2u * 1024 * 1024)
+
+// Largest image SOEM can exchange: one full LRW datagram per segment
+#define PROCESS_IMAGE_MAX  ((size_t)EC_MAXIOSEGMENTS * EC_MAXLRWDATA)
+
+int process_image_alloc(process_image *img, size_t used, int flags)
+{
+    size_t size = (used + PROCESS_IMAGE_CACHE_LINE - 1) & ~(size_t)(PROCESS_IMAGE_CACHE_LINE - 1);
+    if (size == 0)
+        size = PROCESS_IMAGE_CACHE_LINE;
+
+    memset(img, 0, sizeof(*img));
+    img->used = used;
+
+    if ((flags & PROCESS_IMAGE_HUGE_PAGES) && size <= HUGE_PAGE_SIZE)
+    {
+        void *p = mmap(NULL, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            img->base = p;
+            img->size = HUGE_PAGE_SIZE;
+            img->huge = 1;
+            return 1;
+        }
+        fprintf(stderr, "Process image: no huge page (%s), using normal pages\n", strerror(errno));
+    }
+
+    img->base = aligned_alloc(PROCESS_IMAGE_CACHE_LINE, size);
+    if (img->base == NULL)
+        return 0;
+
+    // Zeroing also faults every page in before the cyclic task starts
+    memset(img->base, 0, size);
+    img->size = size;
+    return 1;
+}
+
+void process_image_free(process_image *img)
+{
+    if (img->base == NULL)
+        return;
+
+    if (img->huge)
+        munmap(img->base, HUGE_PAGE_SIZE);
+    else
+        free(img->base);
+    memset(img, 0, sizeof(*img));
+}
+
+void process_image_rebase(const uint8_t *from, uint8_t *to, uint8_t group, int slavecount)
+{
+    for (int slave = 0; slave < slavecount; slave++)
+    {
+        if (ec_slave[slave].group != group)
+            continue;
+        if (ec_slave[slave].outputs)
+            ec_slave[slave].outputs = to + (ec_slave[slave].outputs - from);
+        if (ec_slave[slave].inputs)
+            ec_slave[slave].inputs = to + (ec_slave[slave].inputs - from);
+    }
+
+    if (ec_group[group].outputs)
+        ec_group[group].outputs = to + (ec_group[group].outputs - from);
+    if (ec_group[group].inputs)
+        ec_group[group].inputs = to + (ec_group[group].inputs - from);
+}
+
+/**
+ * SOEM treats group 0 as "every slave": ec_config_map_group(0) would also
+ * map the slaves moved to other groups, programming a second FMMU for them
+ * and letting the group-0 LRW overwrite their outputs every cycle. Map group
+ * 0 with those slaves parked behind ec_slavecount, where SOEM does not look,
+ * then restore the original order. ec_slavet entries carry their own station
+ * address, so moving them does not change which device is addressed.
+ */
+static int map_group0_only(uint8_t *scratch)
+{
+    static ec_slavet saved[EC_MAXSLAVE];
+    static int position[EC_MAXSLAVE];
+    int count = ec_slavecount;
+    int visible = 0;
+
+    for (int slave = 1; slave <= count; slave++)
+    {
+        saved[slave] = ec_slave[slave];
+        if (saved[slave].group == 0)
+            visible++;
+    }
+    if (visible == count)
+        return ec_config_map_group(scratch, 0);
+
+    int fast = 1, slow = visible + 1;
+    for (int slave = 1; slave <= count; slave++)
+    {
+        position[slave] = saved[slave].group == 0 ? fast++ : slow++;
+        ec_slave[position[slave]] = saved[slave];
+    }
+
+    // The SII cache is keyed by slave index, which no longer matches
+    ecx_context.esislave = 0;
+    ec_slavecount = visible;
+    int used = ec_config_map_group(scratch, 0);
+    ec_slavecount = count;
+
+    for (int slave = 1; slave <= count; slave++)
+        saved[slave] = ec_slave[position[slave]];
+    for (int slave = 1; slave <= count; slave++)
+        ec_slave[slave] = saved[slave];
+    ecx_context.esislave = 0;
+    return used;
+}
+
+int process_image_map(process_image *img, uint8_t group, int flags)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t reserve = (PROCESS_IMAGE_MAX + page - 1) & ~(page - 1);
+
+    // Address space only; a trailing PROT_NONE page catches any overrun
+    uint8_t *scratch = mmap(NULL, reserve + page, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (scratch == MAP_FAILED)
+    {
+        perror("mmap");
+        return 0;
+    }
+    mprotect(scratch + reserve, page, PROT_NONE);
+
+    // LRW frames of one group must not hit another group's FMMUs
+    ec_group[group].logstartaddr = (uint32)group << 24;
+    int used = group == 0 ? map_group0_only(scratch) : ec_config_map_group(scratch, group);
+    size_t mapped = (size_t)ec_group[group].Obytes + ec_group[group].Ibytes;
+
+    if (used <= 0 || (size_t)used > PROCESS_IMAGE_MAX || mapped != (size_t)used ||
+        ec_group[group].nsegments > EC_MAXIOSEGMENTS)
+    {
+        printf("✗ Process image of group %u: %d bytes mapped (%u out + %u in, %u segments), limit %zu\n",
+               group, used, ec_group[group].Obytes, ec_group[group].Ibytes, ec_group[group].nsegments,
+               (size_t)PROCESS_IMAGE_MAX);
+        munmap(scratch, reserve + page);
+        return 0;
+    }
+
+    if (!process_image_alloc(img, used, flags))
+    {
+        printf("✗ Process image: cannot allocate %d bytes\n", used);
+        munmap(scratch, reserve + page);
+        return 0;
+    }
+
+    process_image_rebase(scratch, img->base, group, ec_slavecount + 1);
+    munmap(scratch, reserve + page);
+    return 1;
+}
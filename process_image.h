@@ -0,0 +1,66 @@
+/**
+ * Process image allocation
+ *
+ * SOEM maps every slave's process data into one caller-supplied buffer
+ * and only ever stores pointers into it; it never checks the buffer's
+ * size. This module maps group 0 into a reserved region as large as the
+ * biggest image SOEM can describe (EC_MAXIOSEGMENTS frames), checks the
+ * result, and then moves the mapping into a buffer sized to what was
+ * actually mapped:
+ *
+ *   - aligned to a cache line (or backed by a huge page on request), and
+ *     rounded up to whole cache lines, so no other data shares its lines
+ *   - pre-faulted, so the cyclic task never takes a page fault on it
+ *
+ * The wire layout is not changed: SOEM exchanges the image as contiguous
+ * LRW segments, so slaves stay packed inside it.
+ */
+
+#ifndef PROCESS_IMAGE_H
+#define PROCESS_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROCESS_IMAGE_CACHE_LINE  64
+
+// Allocation flags
+#define PROCESS_IMAGE_HUGE_PAGES  0x1   // Try a 2 MB huge page, fall back to normal pages
+
+typedef struct
+{
+    uint8_t *base;
+    size_t   size;          // Allocated bytes (multiple of the cache line)
+    size_t   used;          // Mapped bytes (Obytes + Ibytes of group 0)
+    int      huge;          // Backed by a huge page
+} process_image;
+
+/**
+ * Allocate an image for `used` bytes of process data, zeroed
+ * Returns 1 on success, 0 on failure.
+ */
+int process_image_alloc(process_image *img, size_t used, int flags);
+
+/**
+ * Release an image from process_image_alloc()
+ */
+void process_image_free(process_image *img);
+
+/**
+ * Map `group` with ec_config_map_group() and move it into a right-sized image
+ * Fails (returns 0, prints why) if nothing was mapped or the mapping does
+ * not fit the process data SOEM can exchange. Slaves are left in SAFE-OP
+ * as with ec_config_map(). Each group gets its own 16 MB window of the
+ * logical address space, so group 0 can still grow (hot-plug). Group 0
+ * holds only the slaves still assigned to it, not every slave as in SOEM.
+ */
+int process_image_map(process_image *img, uint8_t group, int flags);
+
+/**
+ * Re-point the slaves of `group` among ec_slave[0..slavecount - 1], and
+ * ec_group[group], from `from` to `to`
+ * Both images must hold the same layout (`to` may be larger).
+ */
+void process_image_rebase(const uint8_t *from, uint8_t *to, uint8_t group, int slavecount);
+
+#endif
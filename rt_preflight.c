@@ -0,0 +1,452 @@
+/**
+ * Host real-time readiness preflight
+ * See rt_preflight.h.
+ *
+ * Everything here goes through sysfs, procfs and one ethtool ioctl, so it
+ * works without ethtool, tuned or irqbalance being installed.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <net/if.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include "rt_preflight.h"
+
+// Idle states with a longer exit latency count as deep
+#define PREFLIGHT_CSTATE_MAX_US  10
+
+#define PREFLIGHT_MAX_IRQS       32
+
+// Check outcome, also the share of the weight it scores (in halves)
+#define RESULT_FAIL  0
+#define RESULT_WARN  1
+#define RESULT_PASS  2
+#define RESULT_NA   -1
+
+static int score;
+static int score_max;
+static int skipped;
+
+// Tuning applied, restored by rt_preflight_restore()
+static int dma_latency_fd = -1;
+static int governor_cpu = -1;
+static char governor_saved[32];
+static int irq_saved_count;
+static struct
+{
+    int  irq;
+    char affinity[64];
+} irq_saved[PREFLIGHT_MAX_IRQS];
+static char coalesce_ifname[IFNAMSIZ];
+static struct ethtool_coalesce coalesce_saved;
+
+static int read_line(const char *path, char *buf, size_t len)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+
+    int ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (ok)
+        buf[strcspn(buf, "\n")] = '\0';
+    return ok;
+}
+
+static int write_str(const char *path, const char *s)
+{
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return 0;
+
+    ssize_t n = write(fd, s, strlen(s));
+    close(fd);
+    return n == (ssize_t)strlen(s);
+}
+
+/**
+ * Is `cpu` in a kernel CPU list such as "2-3,6"?
+ */
+static int cpulist_has(const char *list, int cpu)
+{
+    const char *p = list;
+    while (*p)
+    {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        long hi = lo;
+        if (*end == '-')
+        {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+        }
+        if (cpu >= lo && cpu <= hi)
+            return 1;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return 0;
+}
+
+static void result(int weight, int level, const char *name, const char *fmt, ...)
+{
+    static const char *mark[] = { "✗", "⚠", "✓" };
+    va_list ap;
+
+    if (level == RESULT_NA)
+    {
+        printf("  - %-14s", name);
+        skipped++;
+    }
+    else
+    {
+        printf("  %s %-14s", mark[level], name);
+        score += weight * level;
+        score_max += weight * RESULT_PASS;
+    }
+
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+static void check_governor(int cpu, int tune)
+{
+    char path[96];
+    char gov[32];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+    if (!read_line(path, gov, sizeof(gov)))
+    {
+        result(15, RESULT_NA, "Governor", "no cpufreq (fixed clock or VM)");
+        return;
+    }
+
+    if (strcmp(gov, "performance") != 0 && tune && write_str(path, "performance"))
+    {
+        governor_cpu = cpu;
+        snprintf(governor_saved, sizeof(governor_saved), "%s", gov);
+        printf("    governor %s -> performance\n", gov);
+        read_line(path, gov, sizeof(gov));
+    }
+
+    if (strcmp(gov, "performance") == 0)
+        result(15, RESULT_PASS, "Governor", "performance");
+    else
+        result(15, RESULT_FAIL, "Governor", "%s: frequency changes stretch the cycle (-T sets performance)", gov);
+}
+
+static void check_cstates(int cpu, int tune)
+{
+    if (tune && dma_latency_fd < 0)
+    {
+        // The PM QoS request lasts as long as the file stays open
+        int32_t zero = 0;
+        int fd = open("/dev/cpu_dma_latency", O_WRONLY);
+        if (fd >= 0 && write(fd, &zero, sizeof(zero)) == sizeof(zero))
+            dma_latency_fd = fd;
+        else if (fd >= 0)
+            close(fd);
+    }
+    if (dma_latency_fd >= 0)
+    {
+        result(15, RESULT_PASS, "C-states", "limited by /dev/cpu_dma_latency = 0 us");
+        return;
+    }
+
+    char path[96];
+    char name[32];
+    char deepest[32] = "";
+    long deepest_us = 0;
+    int states = 0;
+
+    for (int s = 0; ; s++)
+    {
+        char val[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/latency", cpu, s);
+        if (!read_line(path, val, sizeof(val)))
+            break;
+        states++;
+        long latency = atol(val);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/disable", cpu, s);
+        if (read_line(path, val, sizeof(val)) && atoi(val) != 0)
+            continue;
+
+        if (latency > deepest_us)
+        {
+            deepest_us = latency;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/name", cpu, s);
+            if (!read_line(path, name, sizeof(name)))
+                snprintf(name, sizeof(name), "state%d", s);
+            snprintf(deepest, sizeof(deepest), "%s", name);
+        }
+    }
+
+    if (states == 0)
+        result(15, RESULT_NA, "C-states", "no cpuidle driver");
+    else if (deepest_us <= PREFLIGHT_CSTATE_MAX_US)
+        result(15, RESULT_PASS, "C-states", "deepest enabled exit latency %ld us", deepest_us);
+    else
+        result(15, RESULT_WARN, "C-states", "%s enabled (exit %ld us); -T holds /dev/cpu_dma_latency at 0",
+               deepest, deepest_us);
+}
+
+static void check_isolcpus(int cpu)
+{
+    char list[128] = "";
+
+    if (cpu < 0)
+    {
+        result(15, RESULT_FAIL, "isolcpus", "no RT CPU configured (cpu = N in the configuration)");
+        return;
+    }
+
+    read_line("/sys/devices/system/cpu/isolated", list, sizeof(list));
+    if (!cpulist_has(list, cpu))
+    {
+        result(15, RESULT_FAIL, "isolcpus", "CPU %d not isolated; boot with isolcpus=%d nohz_full=%d",
+               cpu, cpu, cpu);
+        return;
+    }
+
+    char nohz[128] = "";
+    read_line("/sys/devices/system/cpu/nohz_full", nohz, sizeof(nohz));
+    if (cpulist_has(nohz, cpu))
+        result(15, RESULT_PASS, "isolcpus", "CPU %d isolated, nohz_full", cpu);
+    else
+        result(15, RESULT_PASS, "isolcpus", "CPU %d isolated (tick still running, add nohz_full=%d)", cpu, cpu);
+}
+
+/**
+ * IRQ numbers of the NIC behind `ifname`: its MSI vectors, else the legacy line
+ */
+static int nic_irqs(const char *ifname, int *irqs, int max)
+{
+    char path[128];
+    int n = 0;
+
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/msi_irqs", ifname);
+    DIR *dir = opendir(path);
+    if (dir != NULL)
+    {
+        struct dirent *e;
+        while ((e = readdir(dir)) != NULL && n < max)
+        {
+            if (e->d_name[0] >= '0' && e->d_name[0] <= '9')
+                irqs[n++] = atoi(e->d_name);
+        }
+        closedir(dir);
+    }
+    if (n > 0)
+        return n;
+
+    char val[16];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/irq", ifname);
+    if (read_line(path, val, sizeof(val)) && atoi(val) > 0)
+        irqs[n++] = atoi(val);
+    return n;
+}
+
+static void check_irq_affinity(const char *ifname, int cpu, int tune)
+{
+    int irqs[PREFLIGHT_MAX_IRQS];
+    int n = nic_irqs(ifname, irqs, PREFLIGHT_MAX_IRQS);
+
+    if (n == 0)
+    {
+        result(15, RESULT_NA, "IRQ affinity", "no interrupt found for %s", ifname);
+        return;
+    }
+    if (cpu < 0)
+    {
+        result(15, RESULT_WARN, "IRQ affinity", "%d IRQ(s), not checked without an RT CPU", n);
+        return;
+    }
+
+    char want[16];
+    snprintf(want, sizeof(want), "%d", cpu);
+    int off = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        char path[64];
+        char affinity[64];
+
+        snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irqs[i]);
+        if (!read_line(path, affinity, sizeof(affinity)))
+            continue;
+        if (strcmp(affinity, want) == 0)
+            continue;
+
+        if (tune && irq_saved_count < PREFLIGHT_MAX_IRQS && write_str(path, want))
+        {
+            irq_saved[irq_saved_count].irq = irqs[i];
+            snprintf(irq_saved[irq_saved_count].affinity, sizeof(irq_saved[0].affinity), "%s", affinity);
+            irq_saved_count++;
+            printf("    IRQ %d: CPU %s -> %s\n", irqs[i], affinity, want);
+            continue;
+        }
+        off++;
+    }
+
+    if (off == 0)
+        result(15, RESULT_PASS, "IRQ affinity", "%d IRQ(s) of %s on CPU %d", n, ifname, cpu);
+    else
+        result(15, RESULT_FAIL, "IRQ affinity", "%d of %d IRQ(s) of %s not on CPU %d (-T pins them)",
+               off, n, ifname, cpu);
+}
+
+static int coalesce_ioctl(const char *ifname, struct ethtool_coalesce *ec)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+        return 0;
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    ifr.ifr_data = (char *)ec;
+    int ok = ioctl(sock, SIOCETHTOOL, &ifr) == 0;
+    close(sock);
+    return ok;
+}
+
+static void check_coalescing(const char *ifname, int tune)
+{
+    struct ethtool_coalesce ec = { .cmd = ETHTOOL_GCOALESCE };
+
+    if (!coalesce_ioctl(ifname, &ec))
+    {
+        result(15, RESULT_NA, "Coalescing", "not supported by %s", ifname);
+        return;
+    }
+
+    if ((ec.rx_coalesce_usecs != 0 || ec.use_adaptive_rx_coalesce) && tune)
+    {
+        struct ethtool_coalesce set = ec;
+        set.cmd = ETHTOOL_SCOALESCE;
+        set.rx_coalesce_usecs = 0;
+        set.use_adaptive_rx_coalesce = 0;
+        if (coalesce_ioctl(ifname, &set))
+        {
+            coalesce_saved = ec;
+            snprintf(coalesce_ifname, sizeof(coalesce_ifname), "%s", ifname);
+            printf("    rx-usecs %u%s -> 0\n", ec.rx_coalesce_usecs, ec.use_adaptive_rx_coalesce ? " (adaptive)" : "");
+            ec.cmd = ETHTOOL_GCOALESCE;
+            coalesce_ioctl(ifname, &ec);
+        }
+    }
+
+    if (ec.rx_coalesce_usecs != 0)
+        result(15, RESULT_FAIL, "Coalescing", "rx-usecs %u delays every reply by up to %u us (-T sets 0)",
+               ec.rx_coalesce_usecs, ec.rx_coalesce_usecs);
+    else if (ec.use_adaptive_rx_coalesce)
+        result(15, RESULT_WARN, "Coalescing", "adaptive rx coalescing on");
+    else
+        result(15, RESULT_PASS, "Coalescing", "rx-usecs 0");
+}
+
+static void check_preempt_rt(void)
+{
+    char rt[8] = "";
+    struct utsname u;
+
+    if ((read_line("/sys/kernel/realtime", rt, sizeof(rt)) && rt[0] == '1') ||
+        (uname(&u) == 0 && strstr(u.version, "PREEMPT_RT") != NULL))
+        result(15, RESULT_PASS, "Kernel", "PREEMPT_RT");
+    else if (uname(&u) == 0 && strstr(u.version, "PREEMPT") != NULL)
+        result(15, RESULT_WARN, "Kernel", "PREEMPT, not PREEMPT_RT: expect occasional 100 us+ latencies");
+    else
+        result(15, RESULT_FAIL, "Kernel", "not preemptible, use a PREEMPT_RT kernel");
+}
+
+static void check_rt_throttling(void)
+{
+    char val[32];
+
+    if (!read_line("/proc/sys/kernel/sched_rt_runtime_us", val, sizeof(val)))
+        result(10, RESULT_NA, "RT throttling", "unknown");
+    else if (atol(val) < 0)
+        result(10, RESULT_PASS, "RT throttling", "off");
+    else
+        result(10, RESULT_WARN, "RT throttling", "RT tasks limited to %ld ms per second (sched_rt_runtime_us)",
+               atol(val) / 1000);
+}
+
+int rt_preflight_run(const char *ifname, int cpu, int tune)
+{
+    int check_cpu = cpu >= 0 ? cpu : 0;
+
+    score = 0;
+    score_max = 0;
+    skipped = 0;
+
+    printf("Host RT preflight (CPU %d, %s)%s:\n", check_cpu, ifname, tune ? ", tuning" : "");
+    check_governor(check_cpu, tune);
+    check_cstates(check_cpu, tune);
+    check_isolcpus(cpu);
+    check_irq_affinity(ifname, cpu, tune);
+    check_coalescing(ifname, tune);
+    check_preempt_rt();
+    check_rt_throttling();
+
+    int pct = score_max > 0 ? score * 100 / score_max : 100;
+    if (skipped > 0)
+        printf("  Score: %d/100 (%d check(s) not applicable)\n", pct, skipped);
+    else
+        printf("  Score: %d/100\n", pct);
+
+    if (pct == 100)
+        printf("✓ Host ready for real-time operation\n\n");
+    else if (pct >= 70)
+        printf("⚠ Host partly tuned, expect occasional jitter\n\n");
+    else
+        printf("⚠ Host not tuned for real time, expect cycle overruns\n\n");
+
+    return pct;
+}
+
+void rt_preflight_restore(void)
+{
+    if (coalesce_ifname[0] != '\0')
+    {
+        coalesce_saved.cmd = ETHTOOL_SCOALESCE;
+        coalesce_ioctl(coalesce_ifname, &coalesce_saved);
+        coalesce_ifname[0] = '\0';
+    }
+
+    for (int i = 0; i < irq_saved_count; i++)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq_saved[i].irq);
+        write_str(path, irq_saved[i].affinity);
+    }
+    irq_saved_count = 0;
+
+    if (governor_cpu >= 0)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", governor_cpu);
+        write_str(path, governor_saved);
+        governor_cpu = -1;
+    }
+
+    if (dma_latency_fd >= 0)
+    {
+        close(dma_latency_fd);
+        dma_latency_fd = -1;
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * Host real-time readiness preflight
+ *
+ * Cycle jitter rarely comes from the master itself; it comes from how the
+ * host is set up. Before the slaves go to OP, rt_preflight_run() inspects
+ * the settings that matter for the RT CPU and the EtherCAT NIC and prints
+ * one line per check with a weighted score:
+ *
+ *   governor     cpufreq governor of the RT CPU is "performance"
+ *   C-states     no idle state with an exit latency above a few us, or
+ *                /dev/cpu_dma_latency held at 0
+ *   isolcpus     RT CPU is isolated from the scheduler
+ *   IRQ affinity every NIC interrupt is pinned to the RT CPU, so the
+ *                receive softirq runs where the cyclic task waits
+ *   coalescing   rx-usecs is 0 (the NIC raises the IRQ per frame)
+ *   PREEMPT_RT   kernel is fully preemptible
+ *   throttling   RT throttling (sched_rt_runtime_us) is off
+ *
+ * Checks that do not apply to the host (no cpufreq in a VM, a NIC without
+ * coalescing support) are left out of the score.
+ *
+ * With `tune` set the preflight also fixes what it can at runtime: holds
+ * /dev/cpu_dma_latency at 0 for the life of the process, switches the
+ * governor, pins the NIC IRQs to the RT CPU and turns rx coalescing off.
+ * rt_preflight_restore() puts the governor, IRQ affinity and coalescing
+ * back. isolcpus and the kernel flavour need a reboot and are only
+ * reported.
+ */
+
+#ifndef RT_PREFLIGHT_H
+#define RT_PREFLIGHT_H
+
+/**
+ * Check (and with `tune`, adjust) the host for `ifname` and RT CPU `cpu`
+ * `cpu` < 0 means no affinity is configured; the CPU-specific checks then
+ * look at CPU 0 and the IRQ pinning is skipped. Prints the report and
+ * returns the score, 0..100.
+ */
+int rt_preflight_run(const char *ifname, int cpu, int tune);
+
+/**
+ * Undo the tuning applied by rt_preflight_run() and release
+ * /dev/cpu_dma_latency
+ */
+void rt_preflight_restore(void);
+
+#endif
@@ -0,0 +1,57 @@
+#!/bin/bash
+#
+# Install an ETF qdisc for launch-time scheduling (motor_control -L)
+# Uses the NIC's launch-time offload where the driver supports it (i210,
+# i225/i226, stmmac, ...) and software ETF otherwise:
+#
+#   sudo scripts/etf_setup.sh <interface> [delta_us]
+#   sudo scripts/etf_setup.sh <interface> --remove
+#
+# delta_us is how long before its launch time a frame is handed to the
+# NIC (default 200). Launch offsets passed to -L should be at least this
+# plus the wake-up latency of the cyclic task.
+#
+# With offload the NIC compares launch times against its own PTP clock,
+# which must then follow CLOCK_TAI (e.g. phc2sys). Software ETF uses the
+# system clock and needs nothing else.
+#
+
+set -e
+
+IF=$1
+DELTA_US=${2:-200}
+PRIO=3      # EC_LINK_LAUNCH_PRIORITY in ec_link.h
+
+if [ -z "$IF" ]; then
+    echo "Usage: $0 <interface> [delta_us | --remove]"
+    exit 1
+fi
+
+if [ "$DELTA_US" = "--remove" ]; then
+    tc qdisc del dev "$IF" root 2>/dev/null || true
+    echo "ETF removed from $IF"
+    exit 0
+fi
+
+DELTA_NS=$((DELTA_US * 1000))
+TXQ=$(ls -d /sys/class/net/"$IF"/queues/tx-* | wc -l)
+
+if [ "$TXQ" -gt 1 ]; then
+    # EtherCAT frames (priority $PRIO) to queue 0 under ETF, everything else to queue 1
+    MAP="1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1"
+    MAP=$(echo $MAP | awk -v p=$PRIO '{ $(p + 1) = 0; print }')
+    tc qdisc replace dev "$IF" parent root handle 100 mqprio num_tc 2 map $MAP queues 1@0 1@1 hw 0
+    PARENT="parent 100:1"
+else
+    # Single queue: every frame on the interface goes through ETF
+    PARENT="root"
+fi
+
+if tc qdisc replace dev "$IF" $PARENT etf clockid CLOCK_TAI delta "$DELTA_NS" offload 2>/dev/null; then
+    echo "✓ ETF on $IF with launch-time offload, delta $DELTA_US us"
+elif tc qdisc replace dev "$IF" $PARENT etf clockid CLOCK_TAI delta "$DELTA_NS"; then
+    echo "✓ ETF on $IF in software (no launch-time offload), delta $DELTA_US us"
+else
+    echo "✗ Cannot install ETF on $IF (kernel without CONFIG_NET_SCH_ETF?)"
+    exit 1
+fi
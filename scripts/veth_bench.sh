@@ -0,0 +1,41 @@
+#!/bin/bash
+#
+# Compare raw-socket and AF_XDP round-trip time on a veth pair
+# No EtherCAT hardware needed; run from the repository root as root:
+#
+#   make link_bench && sudo scripts/veth_bench.sh [frames] [interval_us]
+#
+
+set -e
+
+FRAMES=${1:-20000}
+INTERVAL=${2:-500}
+BENCH=./link_bench
+IF_A=ecbench0
+IF_B=ecbench1
+
+if [ ! -x "$BENCH" ]; then
+    echo "Build the benchmark first: make link_bench"
+    exit 1
+fi
+
+cleanup()
+{
+    [ -n "$REFLECTOR" ] && kill "$REFLECTOR" 2>/dev/null || true
+    ip link del "$IF_A" 2>/dev/null || true
+}
+trap cleanup EXIT
+
+ip link add "$IF_A" type veth peer name "$IF_B"
+ip link set "$IF_A" up
+ip link set "$IF_B" up
+
+"$BENCH" reflect "$IF_B" > /dev/null &
+REFLECTOR=$!
+sleep 0.5
+
+echo "=== Raw socket (SOEM default) ==="
+"$BENCH" ping "$IF_A" -n "$FRAMES" -i "$INTERVAL"
+echo ""
+echo "=== AF_XDP ==="
+"$BENCH" ping "$IF_A" -n "$FRAMES" -i "$INTERVAL" -x
@@ -0,0 +1,175 @@
+/**
+ * Example external controller for the shared-memory interface (shm_io.h)
+ *
+ * Attaches to the object created by `motor_control -M NAME`, prints the
+ * feedback of one axis and, with -v, commands a velocity through the
+ * command block. Stands in for a whole-body controller process.
+ *
+ * The command is republished every master cycle, as the setpoint watchdog
+ * requires of every client. Without -w the client paces itself by sleeping
+ * one cycle; with -w it blocks on the cycle futex instead. Either way it
+ * prints every -i ms. Its wake latencies are
+ * recorded in the shared statistics. -e raises the master's e-stop and exits.
+ *
+ * Usage:
+ *   ./shm_client [-a axis] [-v rpm] [-i interval_ms] [-w] [-e] /motor_control
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_io.h"
+
+static shm_io_header *attach(const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        perror(name);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(shm_io_header))
+    {
+        printf("%s: not a motor_control shared-memory object\n", name);
+        close(fd);
+        return NULL;
+    }
+
+    void *mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        perror("mmap");
+        return NULL;
+    }
+
+    // The master writes the magic once the layout is complete
+    shm_io_header *h = mem;
+    for (int i = 0; i < 100 && h->magic != SHM_IO_MAGIC; i++)
+        usleep(10000);
+    atomic_thread_fence(memory_order_acquire);
+
+    if (h->magic != SHM_IO_MAGIC || h->version != SHM_IO_VERSION ||
+        h->header_size + (size_t)h->naxes * h->axis_size > (size_t)st.st_size)
+    {
+        printf("%s: layout not ready or version %u (expected %u)\n", name, h->version, SHM_IO_VERSION);
+        munmap(mem, st.st_size);
+        return NULL;
+    }
+    return h;
+}
+
+int main(int argc, char *argv[])
+{
+    int axis = 0;
+    int interval_ms = 100;
+    double rpm = NAN;
+    int wait_cycle = 0;
+    int estop = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "a:v:i:we")) != -1)
+    {
+        switch (opt)
+        {
+        case 'a':
+            axis = atoi(optarg);
+            break;
+        case 'v':
+            rpm = atof(optarg);
+            break;
+        case 'i':
+            interval_ms = atoi(optarg);
+            break;
+        case 'w':
+            wait_cycle = 1;
+            break;
+        case 'e':
+            estop = 1;
+            break;
+        default:
+            printf("Usage: %s [-a axis] [-v rpm] [-i interval_ms] [-w] [-e] /name\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        printf("Usage: %s [-a axis] [-v rpm] [-i interval_ms] [-w] [-e] /name\n", argv[0]);
+        return 1;
+    }
+
+    shm_io_header *h = attach(argv[optind]);
+    if (h == NULL)
+        return 1;
+    if (axis < 0 || axis >= h->naxes)
+    {
+        printf("Axis %d out of range (%u axes)\n", axis, h->naxes);
+        return 1;
+    }
+
+    if (estop)
+    {
+        shm_io_estop(h);
+        printf("E-stop raised on %s\n", argv[optind]);
+        return 0;
+    }
+
+    shm_io_axis *a = shm_io_axis_at(h, axis);
+    printf("Attached to %s: master pid %d, %u us cycle, axis %d = slave %u\n",
+           argv[optind], h->pid, h->cycle_ns / 1000, axis, a->slave);
+
+    shm_io_command cmd = { 0 };
+    if (!isnan(rpm))
+    {
+        cmd.flags = SHM_IO_CMD_VALID;
+        cmd.target_velocity = (int32_t)lrint(rpm * 2.0 * M_PI / 60.0 / a->rads_per_cps);
+        printf("Commanding %.1f RPM (%d counts/s)\n", rpm, cmd.target_velocity);
+    }
+
+    uint32_t last_cycle = atomic_load(&h->cycle);
+    int64_t next_print_ns = 0;
+
+    for (;;)
+    {
+        if (wait_cycle)
+        {
+            // One iteration per master cycle; a second without one means it is gone
+            if (!shm_io_wait_cycle(h, &last_cycle, 1000))
+            {
+                printf("No cycle for 1 s, master stopped?\n");
+                return 1;
+            }
+        }
+        else
+        {
+            usleep(h->cycle_ns / 1000);
+        }
+
+        // A setpoint that stops changing trips the master's watchdog: publish every cycle
+        if (!isnan(rpm))
+            shm_io_write_command(h, axis, &cmd);
+
+        if (shm_io_now_ns() < next_print_ns)
+            continue;
+        next_print_ns = shm_io_now_ns() + (int64_t)interval_ms * 1000000;
+
+        shm_io_feedback fb;
+        shm_io_read_feedback(h, axis, &fb);
+
+        printf("[%8llu] Status: 0x%04X | Pos: %10d (%8.3f rad) | Vel: %7.2f RPM | WKC: %d | "
+               "Sampled: DC %.6f s%s\n",
+               (unsigned long long)fb.cycle, fb.status_word, fb.actual_position,
+               fb.actual_position * a->rad_per_count,
+               fb.actual_velocity * a->rads_per_cps * 60.0 / (2.0 * M_PI), fb.wkc,
+               fb.dc_sample_ns / 1e9, fb.operational ? "" : " (not operational)");
+    }
+
+    return 0;
+}
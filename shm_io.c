@@ -0,0 +1,143 @@
+/**
+ * Shared-memory setpoint / feedback interface
+ * See shm_io.h for the layout and the seqlock protocol.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_io.h"
+
+// Attempts per cycle before the previous command is kept
+#define COMMAND_READ_TRIES  2
+
+static char shm_name[64];
+static size_t shm_size;
+
+shm_io_header *shm_io_create(const char *name, int naxes, uint32_t cycle_ns)
+{
+    if (name[0] != '/' || strlen(name) >= sizeof(shm_name) || naxes < 1)
+    {
+        printf("Shared memory: name must start with '/' and be shorter than %zu\n", sizeof(shm_name));
+        return NULL;
+    }
+
+    // A stale object left by a crashed run would keep its old layout
+    shm_unlink(name);
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0)
+    {
+        perror("shm_open");
+        return NULL;
+    }
+
+    size_t size = sizeof(shm_io_header) + (size_t)naxes * sizeof(shm_io_axis);
+    if (ftruncate(fd, size) < 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        perror("mmap");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    // Fault the pages in now and keep them resident
+    memset(mem, 0, size);
+    if (mlock(mem, size) < 0)
+        printf("  Warning: shared memory not locked in RAM\n");
+
+    strcpy(shm_name, name);
+    shm_size = size;
+
+    shm_io_header *h = mem;
+    h->version = SHM_IO_VERSION;
+    h->naxes = naxes;
+    h->header_size = sizeof(shm_io_header);
+    h->axis_size = sizeof(shm_io_axis);
+    h->cycle_ns = cycle_ns;
+    h->pid = getpid();
+    return h;
+}
+
+void shm_io_publish(shm_io_header *h)
+{
+    atomic_thread_fence(memory_order_release);
+    h->magic = SHM_IO_MAGIC;
+}
+
+int shm_io_get_command(shm_io_header *h, int axis, shm_io_command *cmd, uint32_t *seq)
+{
+    shm_io_axis *a = shm_io_axis_at(h, axis);
+    shm_io_command tmp;
+
+    for (int i = 0; i < COMMAND_READ_TRIES; i++)
+    {
+        // The sequence number of this copy, not a newer (maybe unfinished) write
+        if (shm_io_try_read(&a->command.seq, &tmp, &a->command.data, sizeof(tmp), seq))
+        {
+            *cmd = tmp;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+shm_io_feedback *shm_io_feedback_begin(shm_io_header *h, int axis)
+{
+    shm_io_axis *a = shm_io_axis_at(h, axis);
+    shm_io_write_begin(&a->feedback.seq);
+    return &a->feedback.data;
+}
+
+void shm_io_feedback_end(shm_io_header *h, int axis)
+{
+    shm_io_write_end(&shm_io_axis_at(h, axis)->feedback.seq);
+}
+
+void shm_io_cycle_done(shm_io_header *h, int64_t now_ns)
+{
+    atomic_store_explicit(&h->publish_ns, now_ns, memory_order_relaxed);
+
+    // Sequentially consistent pair with the waiter's announce-then-check
+    atomic_fetch_add(&h->cycle, 1);
+    if (atomic_load(&h->waiters) > 0)
+        syscall(SYS_futex, &h->cycle, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+void shm_io_get_wake_stats(shm_io_header *h, shm_io_wake_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (h == NULL)
+        return;
+
+    stats->wakeups = atomic_load(&h->wake.wakeups);
+    if (stats->wakeups > 0)
+        stats->latency_avg_ns = atomic_load(&h->wake.latency_sum_ns) / stats->wakeups;
+    stats->latency_max_ns = atomic_load(&h->wake.latency_max_ns);
+    for (int i = 0; i < SHM_IO_WAKE_BUCKETS; i++)
+        stats->histogram[i] = atomic_load(&h->wake.histogram[i]);
+    stats->waiters = atomic_load(&h->waiters);
+}
+
+void shm_io_destroy(shm_io_header *h)
+{
+    if (h == NULL)
+        return;
+
+    munmap(h, shm_size);
+    shm_unlink(shm_name);
+}
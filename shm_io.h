@@ -0,0 +1,327 @@
+/**
+ * Shared-memory setpoint / feedback interface for external control processes
+ *
+ * With -M NAME the master creates the POSIX shared-memory object NAME
+ * (/dev/shm/NAME) holding a fixed, versioned layout:
+ *
+ *   shm_io_header      magic, layout version, sizes, cycle time, cycle counter,
+ *                      wake-latency statistics
+ *   shm_io_axis[n]     per axis: scale factors, feedback block, command block
+ *
+ * Every block starts on its own cache line. Feedback is written by the
+ * cyclic task once per cycle; commands are written by one client process.
+ * Each block is guarded by its own seqlock, so readers never block writers
+ * and the cyclic task never waits on a client:
+ *
+ *   writer  seq odd -> write fields -> seq even
+ *   reader  seq (even) -> copy fields -> seq unchanged? else retry
+ *
+ * The cyclic task tries a command read a bounded number of times and
+ * keeps the previous command if a client is stuck mid-write.
+ *
+ * Cycle notification: `cycle` is a futex word. The cyclic task increments
+ * it once all feedback of a cycle is published and issues one FUTEX_WAKE,
+ * only if `waiters` is non-zero. Any number of client threads or processes
+ * block in shm_io_wait_cycle() until it changes. Each woken client adds
+ * its wake latency (publish to return from the wait) to the statistics in
+ * the header, so the master and any other reader can see them.
+ *
+ * Any client can raise the master's emergency stop with shm_io_estop().
+ *
+ * This header is self-contained (no SOEM) so clients can include it; the
+ * inline helpers at the end are the client side. The layout only grows at
+ * the end of each block; a client checks magic and version, then uses
+ * header_size / axis_size as strides.
+ */
+
+#ifndef SHM_IO_H
+#define SHM_IO_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHM_IO_MAGIC    0x4F494D45u     // "EMIO"
+#define SHM_IO_VERSION  4
+
+// Wake latency histogram: bucket i counts latencies below 2^i us, the last the rest
+#define SHM_IO_WAKE_BUCKETS 12
+
+// Command flags
+#define SHM_IO_CMD_VALID    0x0001      // Targets below are to be used
+
+typedef struct __attribute__((aligned(64)))
+{
+    uint32_t magic;                     // Written last, once the layout is complete
+    uint16_t version;
+    uint16_t naxes;
+    uint32_t header_size;               // sizeof(shm_io_header)
+    uint32_t axis_size;                 // sizeof(shm_io_axis), stride of axis[]
+    uint32_t cycle_ns;
+    int32_t  pid;                       // Master process
+    _Atomic uint32_t cycle;             // Futex word, incremented after feedback of all axes is published
+    _Atomic uint32_t waiters;           // Clients blocked on `cycle`
+    _Atomic int64_t  publish_ns;        // CLOCK_MONOTONIC of the latest increment
+    _Atomic uint32_t estop;             // Set by a client to stop all axes (see estop.h)
+    uint32_t         reserved;
+    _Atomic int64_t  estop_ns;          // CLOCK_MONOTONIC of the client's trigger
+
+    // Written by the clients
+    struct __attribute__((aligned(64)))
+    {
+        _Atomic uint64_t wakeups;
+        _Atomic uint64_t latency_sum_ns;
+        _Atomic uint64_t latency_max_ns;
+        _Atomic uint64_t histogram[SHM_IO_WAKE_BUCKETS];
+    } wake;
+} shm_io_header;
+
+typedef struct
+{
+    uint64_t cycle;                     // Master cycle the inputs belong to
+    int64_t  time_ns;                   // CLOCK_MONOTONIC when the inputs were received
+    int32_t  actual_position;           // 0x6064, counts
+    int32_t  actual_velocity;           // 0x606C, counts/s
+    int16_t  actual_torque;             // 0x6077, per-mille of rated torque
+    uint16_t status_word;               // 0x6041
+    uint16_t error_code;                // 0x603F
+    int8_t   mode_display;              // 0x6061
+    uint8_t  operational;               // Slave in OP and inputs valid
+    int32_t  wkc;                       // Working counter of the frame
+    int64_t  dc_frame_ns;               // DC time the frame passed the reference clock, 0 = none
+    int64_t  dc_sample_ns;              // DC time of the SYNC0 the inputs were latched on
+} shm_io_feedback;
+
+typedef struct
+{
+    uint32_t flags;                     // SHM_IO_CMD_*
+    int32_t  target_position;           // 0x607A, counts (CSP, not used in CSV)
+    int32_t  target_velocity;           // 0x60FF, counts/s (clamped to max_rpm)
+    int16_t  target_torque;             // 0x6071, per-mille (CST, not used in CSV)
+    uint16_t reserved;
+} shm_io_command;
+
+typedef struct __attribute__((aligned(64)))
+{
+    // Written once before the header is published
+    uint16_t slave;
+    uint16_t reserved;
+    uint32_t counts_per_rev;
+    double   rad_per_count;             // Output side, see axis_units.h
+    float    rads_per_cps;
+    float    nm_per_unit;               // 0 if the rated torque is unknown
+
+    // Master -> clients
+    struct __attribute__((aligned(64)))
+    {
+        _Atomic uint32_t seq;
+        shm_io_feedback  data;
+    } feedback;
+
+    // Client -> master
+    struct __attribute__((aligned(64)))
+    {
+        _Atomic uint32_t seq;
+        shm_io_command   data;
+    } command;
+} shm_io_axis;
+
+static inline shm_io_axis *shm_io_axis_at(shm_io_header *h, int axis)
+{
+    return (shm_io_axis *)((uint8_t *)h + h->header_size + (size_t)axis * h->axis_size);
+}
+
+/**
+ * Seqlock primitives, shared by the master and clients
+ */
+static inline void shm_io_write_begin(_Atomic uint32_t *seq)
+{
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void shm_io_write_end(_Atomic uint32_t *seq)
+{
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * One read attempt; returns 1 if `dst` holds a consistent copy, and then
+ * stores the sequence number it was validated against in `*copy_seq`
+ * (may be NULL)
+ */
+static inline int shm_io_try_read(_Atomic uint32_t *seq, void *dst, const void *src, size_t len,
+                                  uint32_t *copy_seq)
+{
+    uint32_t s1 = atomic_load_explicit(seq, memory_order_acquire);
+    if (s1 & 1)
+        return 0;
+    memcpy(dst, src, len);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(seq, memory_order_relaxed) != s1)
+        return 0;
+    if (copy_seq != NULL)
+        *copy_seq = s1;
+    return 1;
+}
+
+/**
+ * Client side: latest feedback of `axis` (spins only while a cycle is publishing)
+ */
+static inline void shm_io_read_feedback(shm_io_header *h, int axis, shm_io_feedback *fb)
+{
+    shm_io_axis *a = shm_io_axis_at(h, axis);
+    while (!shm_io_try_read(&a->feedback.seq, fb, &a->feedback.data, sizeof(*fb), NULL))
+        ;
+}
+
+/**
+ * Client side: publish a command for `axis` (one writer per axis)
+ */
+static inline void shm_io_write_command(shm_io_header *h, int axis, const shm_io_command *cmd)
+{
+    shm_io_axis *a = shm_io_axis_at(h, axis);
+    shm_io_write_begin(&a->command.seq);
+    memcpy(&a->command.data, cmd, sizeof(*cmd));
+    shm_io_write_end(&a->command.seq);
+}
+
+static inline int64_t shm_io_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void shm_io_record_wake(shm_io_header *h, int64_t latency_ns)
+{
+    if (latency_ns < 0)
+        latency_ns = 0;
+
+    int bucket = 0;
+    for (int64_t us = latency_ns / 1000; us > 0 && bucket < SHM_IO_WAKE_BUCKETS - 1; us >>= 1)
+        bucket++;
+
+    atomic_fetch_add_explicit(&h->wake.wakeups, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->wake.latency_sum_ns, latency_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->wake.histogram[bucket], 1, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&h->wake.latency_max_ns, memory_order_relaxed);
+    while ((uint64_t)latency_ns > max &&
+           !atomic_compare_exchange_weak_explicit(&h->wake.latency_max_ns, &max, latency_ns,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+/**
+ * Client side: block until a cycle after `*last` has been published
+ * Updates `*last` and returns 1, or returns 0 after `timeout_ms` (-1 = no
+ * timeout). Returns at once if a cycle was already missed; only waits
+ * that actually slept are counted in the wake statistics.
+ */
+static inline int shm_io_wait_cycle(shm_io_header *h, uint32_t *last, int timeout_ms)
+{
+    uint32_t cycle = atomic_load_explicit(&h->cycle, memory_order_acquire);
+    if (cycle != *last)
+    {
+        *last = cycle;
+        return 1;
+    }
+
+    struct timespec timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+    int slept = 0;
+
+    // Announce before the final check; the master increments before it looks
+    atomic_fetch_add(&h->waiters, 1);
+    while ((cycle = atomic_load(&h->cycle)) == *last)
+    {
+        slept = 1;
+        if (syscall(SYS_futex, &h->cycle, FUTEX_WAIT, *last, timeout_ms >= 0 ? &timeout : NULL,
+                    NULL, 0) < 0 && errno == ETIMEDOUT)
+            break;
+    }
+    atomic_fetch_sub(&h->waiters, 1);
+
+    if (cycle == *last)
+        return 0;
+    if (slept)
+        shm_io_record_wake(h, shm_io_now_ns() - atomic_load_explicit(&h->publish_ns, memory_order_relaxed));
+    *last = cycle;
+    return 1;
+}
+
+/**
+ * Client side: emergency stop, latched by the master until it exits
+ */
+static inline void shm_io_estop(shm_io_header *h)
+{
+    int64_t now = shm_io_now_ns();
+    uint32_t expected = 0;
+
+    atomic_store_explicit(&h->estop_ns, now, memory_order_relaxed);
+    atomic_compare_exchange_strong_explicit(&h->estop, &expected, 1, memory_order_release, memory_order_relaxed);
+}
+
+/**
+ * Master side
+ */
+
+/**
+ * Create, size and lock the shared-memory object `name` ("/motor_control")
+ * Returns the mapped header with the layout filled in but not yet
+ * published, or NULL on failure.
+ */
+shm_io_header *shm_io_create(const char *name, int naxes, uint32_t cycle_ns);
+
+/**
+ * Make the layout visible to clients (after the per-axis fields are set)
+ */
+void shm_io_publish(shm_io_header *h);
+
+/**
+ * Cyclic task: latest consistent command of `axis` into `cmd`
+ * `seq` receives the block's sequence number, which changes with every
+ * client write. Returns 1 if `cmd` was updated, 0 if the command block was
+ * busy (keep using the previous one).
+ */
+int shm_io_get_command(shm_io_header *h, int axis, shm_io_command *cmd, uint32_t *seq);
+
+/**
+ * Cyclic task: begin / end the feedback update of `axis`
+ * Between the two calls the caller fills the returned block in place.
+ */
+shm_io_feedback *shm_io_feedback_begin(shm_io_header *h, int axis);
+void shm_io_feedback_end(shm_io_header *h, int axis);
+
+/**
+ * Cyclic task: feedback of every axis is published for this cycle
+ * One atomic increment, plus one FUTEX_WAKE if clients are waiting.
+ * `now_ns` (CLOCK_MONOTONIC) is the reference for the wake latency.
+ */
+void shm_io_cycle_done(shm_io_header *h, int64_t now_ns);
+
+/**
+ * Wake-latency snapshot, from the statistics the clients record
+ */
+typedef struct
+{
+    uint64_t wakeups;
+    int64_t  latency_avg_ns;
+    int64_t  latency_max_ns;
+    uint64_t histogram[SHM_IO_WAKE_BUCKETS];
+    uint32_t waiters;           // Clients blocked right now
+} shm_io_wake_stats;
+
+void shm_io_get_wake_stats(shm_io_header *h, shm_io_wake_stats *stats);
+
+/**
+ * Unmap and unlink the object
+ */
+void shm_io_destroy(shm_io_header *h);
+
+#endif
@@ -0,0 +1,226 @@
+/**
+ * Slave supervisor
+ * See supervisor.h for the recovery ladder.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ethercat.h"
+#include "supervisor.h"
+#include "topology.h"
+
+// Timeout for the supervisor's own state reads (same value SOEM's examples use)
+#define EC_TIMEOUTMON 500
+
+static pthread_t sup_thread;
+static atomic_int sup_running = 0;
+static int sup_period_us = 10000;
+static int sup_max_attempts = 5;
+static int sup_scan_period_us = 0;
+
+// ec_readstate()/ec_writestate() and the recovery calls, across threads
+static pthread_mutex_t acyclic_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_uchar slave_op[EC_MAXSLAVE];
+static int attempts[EC_MAXSLAVE];
+static uint8 abandoned[EC_MAXSLAVE];
+static supervisor_stats stats;
+
+int supervisor_slave_operational(int slave)
+{
+    return atomic_load_explicit(&slave_op[slave], memory_order_relaxed);
+}
+
+void supervisor_acyclic_lock(void)
+{
+    pthread_mutex_lock(&acyclic_lock);
+}
+
+int supervisor_acyclic_trylock(void)
+{
+    return pthread_mutex_trylock(&acyclic_lock) == 0;
+}
+
+void supervisor_acyclic_unlock(void)
+{
+    pthread_mutex_unlock(&acyclic_lock);
+}
+
+void supervisor_get_stats(supervisor_stats *out)
+{
+    *out = stats;
+}
+
+static void note_attempt(int slave, int success)
+{
+    if (success)
+    {
+        attempts[slave] = 0;
+        return;
+    }
+
+    if (++attempts[slave] >= sup_max_attempts && !abandoned[slave])
+    {
+        abandoned[slave] = 1;
+        stats.given_up++;
+        printf("✗ Supervisor: giving up on slave %d (%s) after %d attempts\n",
+               slave, ec_slave[slave].name, attempts[slave]);
+    }
+}
+
+/**
+ * One pass over all slaves
+ */
+static void check_slaves(void)
+{
+    stats.checks++;
+    ec_readstate();
+    for (int group = 0; group < EC_MAXGROUP; group++)
+        ec_group[group].docheckstate = FALSE;
+
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        ec_slavet *s = &ec_slave[slave];
+
+        if (abandoned[slave])
+            continue;
+
+        atomic_store(&slave_op[slave], s->state == EC_STATE_OPERATIONAL && !s->islost);
+        if (s->state == EC_STATE_OPERATIONAL && !s->islost)
+            continue;
+
+        // Keep checking until this slave is back
+        ec_group[s->group].docheckstate = TRUE;
+
+        if (!s->islost)
+        {
+            if (s->state == (EC_STATE_SAFE_OP + EC_STATE_ERROR))
+            {
+                printf("⚠ Supervisor: slave %d in SAFE-OP + ERROR (AL 0x%04X %s), acknowledging\n",
+                       slave, s->ALstatuscode, ec_ALstatuscode2string(s->ALstatuscode));
+                s->state = EC_STATE_SAFE_OP + EC_STATE_ACK;
+                ec_writestate(slave);
+                stats.acks++;
+            }
+            else if (s->state == EC_STATE_SAFE_OP)
+            {
+                printf("⚠ Supervisor: slave %d in SAFE-OP, requesting OP\n", slave);
+                s->state = EC_STATE_OPERATIONAL;
+                ec_writestate(slave);
+                stats.op_requests++;
+            }
+            else if (s->state > EC_STATE_NONE)
+            {
+                int ok = ec_reconfig_slave(slave, EC_TIMEOUTMON);
+                if (ok)
+                {
+                    s->islost = FALSE;
+                    stats.reconfigs++;
+                    printf("✓ Supervisor: slave %d reconfigured\n", slave);
+                }
+                note_attempt(slave, ok);
+            }
+            else
+            {
+                ec_statecheck(slave, EC_STATE_OPERATIONAL, EC_TIMEOUTRET);
+                if (s->state == EC_STATE_NONE)
+                {
+                    s->islost = TRUE;
+                    stats.lost++;
+                    printf("✗ Supervisor: slave %d (%s) lost\n", slave, s->name);
+                }
+            }
+        }
+        else
+        {
+            if (s->state == EC_STATE_NONE)
+            {
+                int ok = ec_recover_slave(slave, EC_TIMEOUTMON);
+                if (ok)
+                {
+                    s->islost = FALSE;
+                    stats.recoveries++;
+                    printf("✓ Supervisor: slave %d recovered\n", slave);
+                }
+                note_attempt(slave, ok);
+            }
+            else
+            {
+                // Answering again without needing a new address
+                s->islost = FALSE;
+                printf("✓ Supervisor: slave %d found\n", slave);
+            }
+        }
+    }
+}
+
+static void *sup_main(void *arg)
+{
+    struct timespec period;
+    (void)arg;
+
+    period.tv_sec = sup_period_us / 1000000;
+    period.tv_nsec = (sup_period_us % 1000000) * 1000L;
+    int since_scan_us = 0;
+
+    while (atomic_load(&sup_running))
+    {
+        for (int group = 0; group < EC_MAXGROUP; group++)
+        {
+            if (ec_group[group].docheckstate)
+            {
+                supervisor_acyclic_lock();
+                check_slaves();
+                supervisor_acyclic_unlock();
+                break;
+            }
+        }
+
+        // Topology scans share this thread so acyclic traffic stays serialised
+        since_scan_us += sup_period_us;
+        if (sup_scan_period_us > 0 && since_scan_us >= sup_scan_period_us)
+        {
+            since_scan_us = 0;
+            supervisor_acyclic_lock();
+            topology_scan();
+            supervisor_acyclic_unlock();
+        }
+
+        nanosleep(&period, NULL);
+    }
+
+    return NULL;
+}
+
+int supervisor_start(int period_us, int max_attempts, int scan_period_us)
+{
+    sup_period_us = period_us;
+    sup_max_attempts = max_attempts;
+    sup_scan_period_us = scan_period_us;
+    memset(&stats, 0, sizeof(stats));
+    memset(attempts, 0, sizeof(attempts));
+    memset(abandoned, 0, sizeof(abandoned));
+
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+        atomic_store(&slave_op[slave], ec_slave[slave].state == EC_STATE_OPERATIONAL);
+
+    atomic_store(&sup_running, 1);
+    if (pthread_create(&sup_thread, NULL, sup_main, NULL) != 0)
+    {
+        atomic_store(&sup_running, 0);
+        return 0;
+    }
+    return 1;
+}
+
+void supervisor_stop(void)
+{
+    if (!atomic_load(&sup_running))
+        return;
+
+    atomic_store(&sup_running, 0);
+    pthread_join(sup_thread, NULL);
+}
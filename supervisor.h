@@ -0,0 +1,77 @@
+/**
+ * Slave supervisor: brings slaves that dropped out of OP back without
+ * restarting the master
+ *
+ * The cyclic task flags a check by setting ec_group[n].docheckstate when
+ * a group's working counter is short; the supervisor thread then reads the AL
+ * states and walks each slave that is not in OP through SOEM's recovery
+ * ladder:
+ *
+ *   SAFE-OP + error  -> acknowledge the error
+ *   SAFE-OP          -> request OP
+ *   other state      -> ec_reconfig_slave() (re-write SMs/FMMUs, back to SAFE-OP)
+ *   no response      -> mark lost, then ec_recover_slave() once it reappears
+ *                       (re-assigns its station address after a power cycle)
+ *
+ * Only the affected slave is touched; the process data frame keeps
+ * running for everyone else. Each slave gets a bounded number of
+ * consecutive failed attempts before the supervisor gives up on it.
+ *
+ * ec_readstate() / ec_writestate() work on the shared ec_slave[] array, so
+ * every thread doing acyclic state traffic (the supervisor, topology
+ * scans on its thread, the WKC diagnostics) holds the acyclic lock for
+ * the whole pass.
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t checks;            // State checks run
+    uint32_t acks;              // Error acknowledges issued
+    uint32_t op_requests;       // SAFE-OP -> OP requests
+    uint32_t reconfigs;         // Successful ec_reconfig_slave()
+    uint32_t recoveries;        // Successful ec_recover_slave()
+    uint32_t lost;              // Slaves marked lost
+    uint32_t given_up;          // Slaves abandoned after max attempts
+} supervisor_stats;
+
+/**
+ * Start the supervisor thread
+ * `period_us` is the polling interval, `max_attempts` the number of
+ * consecutive failed recovery attempts tolerated per slave.
+ * `scan_period_us` > 0 also runs topology_scan() at that interval.
+ * Returns 1 on success, 0 on failure.
+ */
+int supervisor_start(int period_us, int max_attempts, int scan_period_us);
+
+/**
+ * Stop the supervisor thread
+ */
+void supervisor_stop(void);
+
+/**
+ * 1 if `slave` is in OP and its process data can be trusted
+ * Safe to call from the cyclic task (single atomic load).
+ */
+int supervisor_slave_operational(int slave);
+
+/**
+ * Serialize acyclic state traffic with the supervisor thread
+ * The lock also covers the slave list (ec_slavecount, ec_slave[],
+ * ec_group[0]) against topology changes. supervisor_acyclic_trylock()
+ * returns 1 if it took the lock, 0 if it is busy; for the cyclic task.
+ */
+void supervisor_acyclic_lock(void);
+int supervisor_acyclic_trylock(void);
+void supervisor_acyclic_unlock(void);
+
+/**
+ * Snapshot of the counters
+ */
+void supervisor_get_stats(supervisor_stats *stats);
+
+#endif
@@ -0,0 +1,391 @@
+/**
+ * Hot-plug detection and incremental topology update
+ * See topology.h for the overall flow.
+ *
+ * Process image growth: SOEM sends group 0 as one contiguous logical
+ * range (logstartaddr .. + Obytes + Ibytes) cut into IOsegment[] frames,
+ * and copies every returned segment back into the same buffer. A new
+ * slave therefore only needs its FMMUs pointed behind the current end of
+ * that range; nothing already running is remapped. The enlarged buffer
+ * is prepared here and swapped in by the cyclic task between two frames.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "ethercat.h"
+#include "topology.h"
+#include "process_image.h"
+#include "wkc_monitor.h"
+#include "dc_monitor.h"
+#include "supervisor.h"
+
+typedef struct
+{
+    process_image img;
+    uint32  Ibytes;
+    uint16  nsegments;
+    uint32  IOsegment[EC_MAXIOSEGMENTS];
+    uint16  outputsWKC;
+    uint16  inputsWKC;
+    int     slavecount;
+    int     expected_wkc;      // While the new slave is still in SAFE-OP
+} topo_layout;
+
+static process_image cur;
+static process_image retired;  // Replaced by the last swap, freed by the scan thread
+static int image_flags;
+static uint32 topo_cycle_ns;
+static topology_setup_fn topo_setup;
+
+static topo_layout layout_slot;
+static _Atomic(topo_layout *) pending = NULL;
+
+static atomic_int expected_wkc;
+static uint8 removed[EC_MAXSLAVE];
+static int configured_count;   // Slaves we know about, including unconfigurable ones
+static int joining;            // Added slave still waiting for the image swap
+
+static int slave_wkc(int slave)
+{
+    return (ec_slave[slave].Obytes ? 2 : 0) + (ec_slave[slave].Ibytes ? 1 : 0);
+}
+
+static void recompute_expected(void)
+{
+    int wkc = 0;
+
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        if (!removed[slave])
+            wkc += slave_wkc(slave);
+    }
+
+    atomic_store(&expected_wkc, wkc);
+    wkc_monitor_set_expected(wkc);
+}
+
+int topology_expected_wkc(void)
+{
+    return atomic_load(&expected_wkc);
+}
+
+void topology_init(process_image *img, int image_flags_, uint32_t cycle_ns, topology_setup_fn setup)
+{
+    cur = *img;
+    memset(&retired, 0, sizeof(retired));
+    image_flags = image_flags_;
+    topo_cycle_ns = cycle_ns;
+    topo_setup = setup;
+    configured_count = ec_slavecount;
+    joining = 0;
+    memset(removed, 0, sizeof(removed));
+    atomic_store(&expected_wkc, (ec_group[0].outputsWKC * 2) + ec_group[0].inputsWKC);
+}
+
+int topology_apply_pending(void)
+{
+    topo_layout *l = atomic_load_explicit(&pending, memory_order_acquire);
+    if (l == NULL)
+        return 0;
+
+    // The supervisor and the WKC diagnostics walk the slave list under the
+    // acyclic lock. The cyclic task must not wait for it: retry next cycle.
+    if (!supervisor_acyclic_trylock())
+        return 0;
+
+    // Latest outputs and inputs carry over; the new slave's area starts zeroed
+    memcpy(l->img.base, cur.base, cur.used);
+    process_image_rebase(cur.base, l->img.base, 0, l->slavecount);
+
+    ec_slave[0].Ibytes = l->Ibytes;
+    ec_group[0].Ibytes = l->Ibytes;
+    ec_group[0].nsegments = l->nsegments;
+    memcpy(ec_group[0].IOsegment, l->IOsegment, sizeof(l->IOsegment));
+    ec_group[0].outputsWKC = l->outputsWKC;
+    ec_group[0].inputsWKC = l->inputsWKC;
+    ec_slavecount = l->slavecount;
+    supervisor_acyclic_unlock();
+
+    atomic_store(&expected_wkc, l->expected_wkc);
+    wkc_monitor_set_expected(l->expected_wkc);
+    dc_monitor_rescan();
+
+    retired = cur;
+    cur = l->img;
+
+    atomic_store_explicit(&pending, NULL, memory_order_release);
+    return 1;
+}
+
+static void report_ports(int slave)
+{
+    uint16 dl = ec_FPRDw(ec_slave[slave].configadr, ECT_REG_DLSTAT, EC_TIMEOUTRET);
+
+    // DL status bits 4..7: physical link on ports 0..3
+    printf("    Slave %d (%s) link: port0 %s, port1 %s, port2 %s, port3 %s\n",
+           slave, ec_slave[slave].name,
+           (dl & 0x0010) ? "up" : "down", (dl & 0x0020) ? "up" : "down",
+           (dl & 0x0040) ? "up" : "down", (dl & 0x0080) ? "up" : "down");
+}
+
+/**
+ * Give the new slave the same system time as the reference clock
+ * Running slaves are left alone (re-running ec_configdc() would reset
+ * every slave's offset and shift SYNC0 on the whole chain). The
+ * propagation delay is the previous slave's delay plus half the loop
+ * time it measured between its two ports.
+ */
+static void configure_dc(int n, int prev)
+{
+    int ref = ec_group[0].DCnext;
+    int32 latch = 0;
+    int64 ref_sof = 0, ref_offset = 0, new_sof = 0;
+    uint32 prev_rx[2] = { 0, 0 };
+    int32 prev_delay = 0;
+
+    if (ref <= 0 || prev <= 0 || !ec_slave[prev].hasdc)
+        return;
+
+    // Latch port receive times on every slave; this does not touch the clocks
+    ec_BWR(0x0000, ECT_REG_DCTIME0, sizeof(latch), &latch, EC_TIMEOUTRET);
+
+    ec_FPRD(ec_slave[ref].configadr, ECT_REG_DCSOF, sizeof(ref_sof), &ref_sof, EC_TIMEOUTRET);
+    ec_FPRD(ec_slave[ref].configadr, ECT_REG_DCSYSOFFSET, sizeof(ref_offset), &ref_offset, EC_TIMEOUTRET);
+    ec_FPRD(ec_slave[n].configadr, ECT_REG_DCSOF, sizeof(new_sof), &new_sof, EC_TIMEOUTRET);
+    ec_FPRD(ec_slave[prev].configadr, ECT_REG_DCTIME0, sizeof(prev_rx), prev_rx, EC_TIMEOUTRET);
+    ec_FPRD(ec_slave[prev].configadr, ECT_REG_DCSYSDELAY, sizeof(prev_delay), &prev_delay, EC_TIMEOUTRET);
+
+    int32 delay = etohl(prev_delay) + (int32)(etohl(prev_rx[1]) - etohl(prev_rx[0])) / 2;
+    int64 offset = etohll(ref_sof) + etohll(ref_offset) + delay - etohll(new_sof);
+
+    offset = htoell(offset);
+    delay = htoel(delay);
+    ec_FPWR(ec_slave[n].configadr, ECT_REG_DCSYSOFFSET, sizeof(offset), &offset, EC_TIMEOUTRET);
+    ec_FPWR(ec_slave[n].configadr, ECT_REG_DCSYSDELAY, sizeof(delay), &delay, EC_TIMEOUTRET);
+
+    ec_slave[n].pdelay = etohl(delay);
+    ec_slave[n].DCprevious = prev;
+    ec_slave[n].DCnext = 0;
+    ec_slave[prev].DCnext = n;
+
+    ec_dcsync0(n, TRUE, topo_cycle_ns, 0);
+}
+
+/**
+ * Second half of adding slave `n`, once its outputs are in the frame
+ */
+static void finish_join(int n)
+{
+    ec_slavet *s = &ec_slave[n];
+
+    s->state = EC_STATE_OPERATIONAL;
+    ec_writestate(n);
+    ec_statecheck(n, EC_STATE_OPERATIONAL, EC_TIMEOUTSTATE);
+    recompute_expected();
+    joining = 0;
+
+    printf("✓ Topology: slave %d (%s) in %s, image %u -> %u bytes, expected WKC %d\n",
+           n, s->name, s->state == EC_STATE_OPERATIONAL ? "OP" : "SAFE-OP (supervisor will retry)",
+           (unsigned)(cur.used - s->Obytes - s->Ibytes), (unsigned)cur.used, topology_expected_wkc());
+}
+
+/**
+ * Configure the slave at chain position `n` (one behind the current end)
+ * Returns 1 if it was added to the process image.
+ */
+static int add_slave(int n)
+{
+    ec_slavet *s = &ec_slave[n];
+    uint16 configadr = EC_NODEOFFSET + n;
+    int tmpl = 0;
+
+    if (ec_APWRw((uint16)(1 - n), ECT_REG_STADR, htoes(configadr), EC_TIMEOUTRET3) <= 0)
+        return 0;
+
+    s->configadr = configadr;
+    uint32 man = etohl(ec_readeeprom(n, ECT_SII_MANUF, EC_TIMEOUTEEP));
+    uint32 id = etohl(ec_readeeprom(n, ECT_SII_ID, EC_TIMEOUTEEP));
+    uint32 rev = etohl(ec_readeeprom(n, ECT_SII_REV, EC_TIMEOUTEEP));
+
+    printf("\n✓ Topology: new slave at position %d (vendor 0x%08X, product 0x%08X)\n", n, man, id);
+
+    // Clone the configuration of a running twin
+    for (int slave = 1; slave < n && !tmpl; slave++)
+    {
+        if (ec_slave[slave].eep_man == man && ec_slave[slave].eep_id == id && !removed[slave])
+            tmpl = slave;
+    }
+
+    ec_slavet *t = &ec_slave[tmpl];
+    if (tmpl == 0 || t->group != 0 || t->Ostartbit || t->Istartbit ||
+        (t->Obits % 8) || (t->Ibits % 8) || t->Obytes + t->Ibytes == 0)
+    {
+        printf("    No byte-aligned running slave of this type to clone, restart to use it\n");
+        return 0;
+    }
+
+    uint32 added = t->Obytes + t->Ibytes;
+    uint16 last = ec_group[0].nsegments ? ec_group[0].nsegments - 1 : 0;
+    // Same segment limit as SOEM's mapping: the first frame also carries the DC datagram
+    int extend = ec_group[0].IOsegment[last] + added <= EC_MAXLRWDATA - EC_FIRSTDCDATAGRAM;
+    if (!extend && ec_group[0].nsegments >= EC_MAXIOSEGMENTS)
+    {
+        printf("    Process image cannot grow by %u bytes\n", added);
+        return 0;
+    }
+
+    // Logical addresses behind the current end of the group's range
+    uint32 log_end = ec_group[0].logstartaddr + cur.used;
+    uint32 tmpl_out_log = ec_group[0].logstartaddr + (t->outputs ? (uint32)(t->outputs - cur.base) : 0);
+    uint32 tmpl_in_log = ec_group[0].logstartaddr + (t->inputs ? (uint32)(t->inputs - cur.base) : 0);
+
+    *s = *t;
+    s->configadr = configadr;
+    s->aliasadr = etohs(ec_FPRDw(configadr, ECT_REG_ALIAS, EC_TIMEOUTRET));
+    s->eep_man = man;
+    s->eep_id = id;
+    s->eep_rev = rev;
+    s->state = EC_STATE_NONE;
+    s->ALstatuscode = 0;
+    s->islost = FALSE;
+    s->parent = n - 1;
+    s->parentport = 1;
+    s->entryport = 0;
+    s->topology = 1;
+    s->outputs = NULL;
+    s->inputs = NULL;
+
+    for (int f = 0; f < s->FMMUunused && f < EC_MAXFMMU; f++)
+    {
+        if (s->FMMU[f].FMMUtype == 2)
+            s->FMMU[f].LogStart = log_end + (t->FMMU[f].LogStart - tmpl_out_log);
+        else if (s->FMMU[f].FMMUtype == 1)
+            s->FMMU[f].LogStart = log_end + t->Obytes + (t->FMMU[f].LogStart - tmpl_in_log);
+    }
+
+    // INIT -> SMs -> PRE-OP -> SAFE-OP -> FMMUs
+    if (ec_reconfig_slave(n, EC_TIMEOUTRET3) != EC_STATE_SAFE_OP)
+    {
+        printf("    Slave %d did not reach SAFE-OP\n", n);
+        return 0;
+    }
+
+    if (s->hasdc)
+        configure_dc(n, n - 1);
+
+    if (topo_setup && !topo_setup(n))
+        printf("    Warning: application setup of slave %d failed\n", n);
+
+    // Enlarged image, swapped in by the cyclic task
+    topo_layout *l = &layout_slot;
+    if (!process_image_alloc(&l->img, cur.used + added, image_flags))
+        return 0;
+
+    s->outputs = t->Obytes ? l->img.base + cur.used : NULL;
+    s->inputs = t->Ibytes ? l->img.base + cur.used + t->Obytes : NULL;
+
+    l->Ibytes = ec_group[0].Ibytes + added;
+    l->nsegments = ec_group[0].nsegments;
+    memcpy(l->IOsegment, ec_group[0].IOsegment, sizeof(l->IOsegment));
+    if (extend)
+        l->IOsegment[last] += added;
+    else
+        l->IOsegment[l->nsegments++] = added;
+    l->outputsWKC = ec_group[0].outputsWKC + (t->Obytes ? 1 : 0);
+    l->inputsWKC = ec_group[0].inputsWKC + (t->Ibytes ? 1 : 0);
+    l->slavecount = n;
+    // Outputs are not processed before OP, only the input read counts yet
+    l->expected_wkc = atomic_load(&expected_wkc) + (t->Ibytes ? 1 : 0);
+
+    atomic_store_explicit(&pending, l, memory_order_release);
+
+    // Wait for the cycle boundary (bounded; the cyclic task may be stopping)
+    for (int i = 0; i < 1000 && atomic_load_explicit(&pending, memory_order_acquire); i++)
+    {
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+    if (atomic_load(&pending))
+    {
+        // Left published; the next scan finishes the join after the swap
+        printf("    Cyclic task did not pick up the new layout yet\n");
+        joining = n;
+        return 0;
+    }
+
+    finish_join(n);
+    return 1;
+}
+
+void topology_scan(void)
+{
+    uint16 w = 0;
+
+    // Free the image the last swap replaced
+    if (atomic_load(&pending) == NULL)
+    {
+        process_image_free(&retired);
+        if (joining)
+            finish_join(joining);
+    }
+
+    int responding = ec_BRD(0x0000, ECT_REG_TYPE, sizeof(w), &w, EC_TIMEOUTSAFE);
+    if (responding <= 0)
+        return;
+
+    // Removed / returned slaves, as tracked by the supervisor
+    int changed = 0;
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        uint8 gone = ec_slave[slave].islost ? 1 : 0;
+        if (gone == removed[slave])
+            continue;
+
+        if (!gone && ec_slave[slave].state != EC_STATE_OPERATIONAL)
+            continue;   // Count it again once it is back in OP
+
+        removed[slave] = gone;
+        changed = 1;
+        printf("\n%s Topology: slave %d (%s) %s\n", gone ? "⚠" : "✓", slave, ec_slave[slave].name,
+               gone ? "removed from the chain" : "back in the chain");
+        if (gone && slave > 1)
+            report_ports(slave - 1);
+    }
+    if (changed)
+    {
+        recompute_expected();
+        printf("    Expected WKC now %d (%d of %d slaves answering)\n",
+               topology_expected_wkc(), responding, ec_slavecount);
+    }
+
+    // New slaves behind the last configured one
+    if (responding > configured_count && atomic_load(&pending) == NULL)
+    {
+        report_ports(ec_slavecount);
+        while (responding > configured_count && configured_count + 1 < EC_MAXSLAVE)
+        {
+            // Unconfigurable slaves still occupy their position
+            if (!add_slave(++configured_count))
+                break;
+        }
+    }
+    else if (responding < configured_count && configured_count > ec_slavecount)
+    {
+        // An unconfigured tail device was unplugged again
+        configured_count = responding > ec_slavecount ? responding : ec_slavecount;
+    }
+}
+
+void topology_release(void)
+{
+    if (atomic_load(&pending) != NULL)
+    {
+        process_image_free(&layout_slot.img);
+        atomic_store(&pending, NULL);
+    }
+    process_image_free(&retired);
+    process_image_free(&cur);
+}
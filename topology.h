@@ -0,0 +1,70 @@
+/**
+ * Hot-plug detection and incremental topology update
+ *
+ * topology_scan() runs at low rate on the supervisor thread. Each scan
+ * counts the slaves that answer a broadcast read and compares that with
+ * the configured chain:
+ *
+ *   - Slaves that stopped answering (marked lost by the supervisor) are
+ *     dropped from the expected working counter, so the rest of the chain
+ *     keeps running without a flood of WKC anomalies. A drive swapped at
+ *     the same position is re-addressed by the supervisor's
+ *     ec_recover_slave() path and counted again once it is back in OP.
+ *
+ *   - Slaves appended behind the last configured one are configured on
+ *     their own: station address, SII identity, SM/FMMU settings cloned
+ *     from an already running slave of the same type, DC offset, and the
+ *     application's setup hook. Their process data is appended to the end
+ *     of a new process image, which the cyclic task swaps in at a cycle
+ *     boundary (topology_apply_pending()), so no frame is lost.
+ *
+ * Devices without a running twin to clone from are reported but left
+ * unconfigured; they need a restart.
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdint.h>
+#include "process_image.h"
+
+/**
+ * Application setup for a newly added slave (SDO writes etc.)
+ * Called in SAFE-OP before the slave's process data goes live.
+ * Returns 1 on success.
+ */
+typedef int (*topology_setup_fn)(uint16_t slave);
+
+/**
+ * Record the initial layout after process_image_map()
+ * Takes ownership of `img`; grown images are allocated with `image_flags`
+ * (PROCESS_IMAGE_*). Release everything with topology_release().
+ */
+void topology_init(process_image *img, int image_flags, uint32_t cycle_ns, topology_setup_fn setup);
+
+/**
+ * One scan; non-RT, called from the supervisor thread
+ */
+void topology_scan(void);
+
+/**
+ * Swap in a pending process image, if any
+ * Called by the cyclic task at the cycle boundary, right before
+ * ec_send_processdata(). The slave list is updated under the supervisor's
+ * acyclic lock; while another thread holds it the swap waits for a later
+ * cycle. Returns 1 if the layout changed, in which case cached
+ * ec_slave[].outputs / inputs pointers must be re-read.
+ */
+int topology_apply_pending(void);
+
+/**
+ * Expected working counter for the slaves currently in the chain
+ */
+int topology_expected_wkc(void);
+
+/**
+ * Free the current process image (after the cyclic task has stopped)
+ */
+void topology_release(void);
+
+#endif
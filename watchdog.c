@@ -0,0 +1,33 @@
+/**
+ * Setpoint staleness watchdog and slave-side SM watchdog
+ * See watchdog.h.
+ */
+
+#include <stdio.h>
+#include "ethercat.h"
+#include "watchdog.h"
+
+// ESC watchdog registers (not in SOEM's register list)
+#define ESC_REG_WD_DIVIDER  0x0400
+#define ESC_REG_WD_TIME_SM  0x0420
+
+// Divider for a 100 us tick: (divider + 2) x 40 ns
+#define WD_DIVIDER_100US    2498
+
+int watchdog_sm_configure(uint16_t slave, uint32_t timeout_ms)
+{
+    if (timeout_ms == 0)
+        return 1;
+
+    uint16 configadr = ec_slave[slave].configadr;
+    uint16 ticks = (uint16)(timeout_ms * 10);
+
+    if (ec_FPWRw(configadr, ESC_REG_WD_DIVIDER, htoes(WD_DIVIDER_100US), EC_TIMEOUTRET3) <= 0 ||
+        ec_FPWRw(configadr, ESC_REG_WD_TIME_SM, htoes(ticks), EC_TIMEOUTRET3) <= 0)
+        return 0;
+
+    // Read back: some ESCs fix the divider
+    uint16 divider = etohs(ec_FPRDw(configadr, ESC_REG_WD_DIVIDER, EC_TIMEOUTRET3));
+    uint16 time = etohs(ec_FPRDw(configadr, ESC_REG_WD_TIME_SM, EC_TIMEOUTRET3));
+    return divider == WD_DIVIDER_100US && time == ticks;
+}
@@ -0,0 +1,77 @@
+/**
+ * Setpoint staleness watchdog and slave-side SM watchdog
+ *
+ * Two failure modes leave a drive running on an old command:
+ *
+ *   - The external controller stops updating its setpoint while the
+ *     master keeps cycling. setpoint_watchdog_check() tracks the age of
+ *     the last fresh setpoint (a changed command sequence number) on the
+ *     cyclic task's time grid. Once it exceeds the timeout the caller
+ *     commands a quick stop (control word, reaction set by 0x605A). This
+ *     is O(1) per axis per cycle.
+ *
+ *   - The master itself stops sending frames (process hung, host
+ *     overloaded). Only the slave can notice: the ESC's sync manager
+ *     watchdog (0x0400 divider, 0x0420 time) expires when the output
+ *     sync manager is not written in time, and the slave drops to
+ *     SAFE-OP with outputs in their safe state.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t seq;               // Sequence number of the last fresh setpoint
+    int64_t  fresh_ns;          // When it was seen
+    int      active;            // A setpoint has been seen since the last reset
+    int      tripped;           // Stale right now
+    uint64_t trips;             // Fresh -> stale transitions
+    int64_t  max_interval_ns;   // Longest gap between fresh setpoints that did not trip
+} setpoint_watchdog;
+
+static inline void setpoint_watchdog_reset(setpoint_watchdog *w)
+{
+    w->active = 0;
+    w->tripped = 0;
+}
+
+/**
+ * Per-cycle check; `now_ns` is the cycle start on the scheduler grid
+ * Returns 1 while the setpoint is older than `timeout_ns`.
+ */
+static inline int setpoint_watchdog_check(setpoint_watchdog *w, uint32_t seq, int64_t now_ns, int64_t timeout_ns)
+{
+    if (!w->active || seq != w->seq)
+    {
+        int64_t interval = now_ns - w->fresh_ns;
+        if (w->active && !w->tripped && interval > w->max_interval_ns)
+            w->max_interval_ns = interval;
+
+        w->seq = seq;
+        w->fresh_ns = now_ns;
+        w->active = 1;
+        w->tripped = 0;
+        return 0;
+    }
+
+    if (now_ns - w->fresh_ns > timeout_ns)
+    {
+        if (!w->tripped)
+            w->trips++;
+        w->tripped = 1;
+    }
+    return w->tripped;
+}
+
+/**
+ * Set the SM watchdog of `slave` to `timeout_ms` (0: leave the ESC default)
+ * Uses a 100 us watchdog tick; the process-data sync managers must have
+ * their watchdog enabled (SM control bit 6, set by SOEM for outputs).
+ * Returns 1 on success.
+ */
+int watchdog_sm_configure(uint16_t slave, uint32_t timeout_ms);
+
+#endif
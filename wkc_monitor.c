@@ -0,0 +1,229 @@
+/**
+ * Working-counter anomaly detection and per-slave fault localization
+ * See wkc_monitor.h for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "ethercat.h"
+#include "wkc_monitor.h"
+#include "supervisor.h"
+
+// ESC error counter block 0x0300-0x0313
+typedef struct __attribute__((__packed__))
+{
+    struct
+    {
+        uint8 invalid_frame;   // 0x0300 + 2n: frames with CRC/format errors
+        uint8 rx_error;        // 0x0301 + 2n: physical layer RX errors
+    } port[4];
+    uint8 fwd_rx_error[4];     // 0x0308-0x030B: errors detected by a previous slave
+    uint8 ecat_pu_error;       // 0x030C: processing unit errors
+    uint8 pdi_error;           // 0x030D
+    uint16 pdi_error_code;     // 0x030E
+    uint8 lost_link[4];        // 0x0310-0x0313
+} esc_error_counters;
+
+static int expected = 0;
+static uint32_t threshold = 3;
+
+// Written by the cyclic task only
+static wkc_stats stats;
+
+// What the diagnostics thread reads of it
+static _Atomic uint32_t run_length;
+static atomic_int run_wkc;
+
+static sem_t diag_sem;
+static pthread_t diag_thread;
+static atomic_int diag_pending = 0;
+static atomic_int diag_running = 0;
+
+static esc_error_counters last_counters[EC_MAXSLAVE];
+static uint8 have_counters[EC_MAXSLAVE];
+
+uint32_t wkc_monitor_check(int wkc)
+{
+    stats.cycles++;
+    stats.last_wkc = wkc;
+
+    if (wkc == expected)
+    {
+        if (stats.consecutive != 0)
+            atomic_store_explicit(&run_length, 0, memory_order_relaxed);
+        stats.consecutive = 0;
+        return 0;
+    }
+
+    stats.misses++;
+    stats.consecutive++;
+    atomic_store_explicit(&run_length, stats.consecutive, memory_order_relaxed);
+    atomic_store_explicit(&run_wkc, wkc, memory_order_relaxed);
+    if (stats.consecutive > stats.max_consecutive)
+        stats.max_consecutive = stats.consecutive;
+
+    // Hand the expensive part to the diagnostics thread, once per episode
+    if (stats.consecutive == threshold)
+    {
+        stats.episodes++;
+        if (!atomic_exchange(&diag_pending, 1))
+            sem_post(&diag_sem);
+    }
+
+    return stats.consecutive;
+}
+
+void wkc_monitor_set_expected(int expected_wkc)
+{
+    expected = expected_wkc;
+}
+
+void wkc_monitor_get_stats(wkc_stats *out)
+{
+    *out = stats;
+}
+
+/**
+ * Read the error counters of one slave and print what changed
+ * Returns 1 if any counter moved since the previous reading.
+ */
+static int check_error_counters(int slave)
+{
+    esc_error_counters now;
+    esc_error_counters *prev = &last_counters[slave];
+    int changed = 0;
+
+    memset(&now, 0, sizeof(now));
+    if (ec_FPRD(ec_slave[slave].configadr, ECT_REG_RXERR, sizeof(now), &now, EC_TIMEOUTRET) <= 0)
+    {
+        printf("    Slave %d (%s): no response to error counter read\n", slave, ec_slave[slave].name);
+        return 1;
+    }
+
+    if (have_counters[slave])
+    {
+        for (int p = 0; p < 4; p++)
+        {
+            // Counters are 8-bit and saturate; unsigned subtraction handles the common case
+            uint8 inv = now.port[p].invalid_frame - prev->port[p].invalid_frame;
+            uint8 rx = now.port[p].rx_error - prev->port[p].rx_error;
+            uint8 fwd = now.fwd_rx_error[p] - prev->fwd_rx_error[p];
+            uint8 lost = now.lost_link[p] - prev->lost_link[p];
+
+            if (inv || rx || fwd || lost)
+            {
+                changed = 1;
+                printf("    Slave %d (%s) port %d: +%u invalid, +%u RX errors, +%u forwarded, +%u lost link%s\n",
+                       slave, ec_slave[slave].name, p, inv, rx, fwd, lost,
+                       (inv || rx) && !fwd ? "  <- fault on the cable into this port" : "");
+            }
+        }
+
+        if (now.ecat_pu_error != prev->ecat_pu_error)
+        {
+            changed = 1;
+            printf("    Slave %d (%s): +%u processing unit errors\n", slave, ec_slave[slave].name,
+                   (uint8)(now.ecat_pu_error - prev->ecat_pu_error));
+        }
+    }
+
+    *prev = now;
+    have_counters[slave] = 1;
+    return changed;
+}
+
+/**
+ * Locate the faulty slave(s)
+ */
+static void diagnose(void)
+{
+    int faulty = 0;
+
+    printf("\n⚠ WKC anomaly: %d/%d for %u cycles, checking slaves...\n",
+           atomic_load_explicit(&run_wkc, memory_order_relaxed), expected,
+           atomic_load_explicit(&run_length, memory_order_relaxed));
+
+    ec_readstate();
+
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+    {
+        int bad_state = ec_slave[slave].state != EC_STATE_OPERATIONAL;
+
+        if (bad_state)
+        {
+            faulty++;
+            printf("    Slave %d (%s): state 0x%02X, AL status 0x%04X (%s)\n",
+                   slave, ec_slave[slave].name, ec_slave[slave].state,
+                   ec_slave[slave].ALstatuscode, ec_ALstatuscode2string(ec_slave[slave].ALstatuscode));
+        }
+
+        if (check_error_counters(slave) && !bad_state)
+            faulty++;
+    }
+
+    if (faulty == 0)
+        printf("    All slaves in OP with no new errors (frame loss on the master side?)\n");
+}
+
+static void *diag_main(void *arg)
+{
+    (void)arg;
+
+    // Baseline so the first anomaly reports deltas, not lifetime totals
+    supervisor_acyclic_lock();
+    for (int slave = 1; slave <= ec_slavecount; slave++)
+        check_error_counters(slave);
+    supervisor_acyclic_unlock();
+
+    while (atomic_load(&diag_running))
+    {
+        sem_wait(&diag_sem);
+        if (!atomic_load(&diag_running))
+            break;
+
+        supervisor_acyclic_lock();
+        diagnose();
+        supervisor_acyclic_unlock();
+
+        // Wait for this episode to end before allowing the next report
+        while (atomic_load(&diag_running) && atomic_load_explicit(&run_length, memory_order_relaxed) != 0)
+        {
+            struct timespec ts = { 0, 10000000 };
+            nanosleep(&ts, NULL);
+        }
+        atomic_store(&diag_pending, 0);
+    }
+
+    return NULL;
+}
+
+int wkc_monitor_start(int expected_wkc, int miss_threshold)
+{
+    expected = expected_wkc;
+    threshold = miss_threshold > 0 ? miss_threshold : 1;
+    memset(&stats, 0, sizeof(stats));
+    atomic_store(&run_length, 0);
+
+    sem_init(&diag_sem, 0, 0);
+    atomic_store(&diag_running, 1);
+    if (pthread_create(&diag_thread, NULL, diag_main, NULL) != 0)
+    {
+        atomic_store(&diag_running, 0);
+        return 0;
+    }
+    return 1;
+}
+
+void wkc_monitor_stop(void)
+{
+    if (!atomic_load(&diag_running))
+        return;
+
+    atomic_store(&diag_running, 0);
+    sem_post(&diag_sem);
+    pthread_join(diag_thread, NULL);
+    sem_destroy(&diag_sem);
+}
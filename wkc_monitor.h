@@ -0,0 +1,61 @@
+/**
+ * Working-counter anomaly detection and per-slave fault localization
+ *
+ * The cyclic task calls wkc_monitor_check() once per cycle; that is a
+ * single comparison and counter update. When the working counter has
+ * been wrong for `miss_threshold` consecutive cycles, a diagnostics thread
+ * is woken to find out which slave is at fault:
+ *
+ *   - AL status and AL status code of every slave (0x0130 / 0x0134)
+ *   - ESC error counters 0x0300-0x0313 (per-port RX/invalid frame counts,
+ *     forwarded RX errors, processing unit errors, lost link counters),
+ *     compared against the previous reading so only new errors are shown
+ *
+ * One report is printed per anomaly episode; the episode ends when the
+ * working counter is correct again. Bringing slaves back to OP is the
+ * supervisor's job (supervisor.c).
+ */
+
+#ifndef WKC_MONITOR_H
+#define WKC_MONITOR_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t cycles;            // Cycles checked
+    uint64_t misses;            // Cycles with a wrong working counter
+    uint64_t episodes;          // Anomalies that reached the threshold
+    uint32_t consecutive;       // Current run of wrong cycles
+    uint32_t max_consecutive;   // Longest run seen
+    int      last_wkc;
+} wkc_stats;
+
+/**
+ * Start the diagnostics thread
+ * Returns 1 on success, 0 on failure.
+ */
+int wkc_monitor_start(int expected_wkc, int miss_threshold);
+
+/**
+ * Stop the diagnostics thread
+ */
+void wkc_monitor_stop(void);
+
+/**
+ * Per-cycle check, called from the cyclic task after receive
+ * Returns the number of consecutive cycles the working counter has been wrong.
+ */
+uint32_t wkc_monitor_check(int wkc);
+
+/**
+ * Update the expected working counter (e.g. after the slave set changed)
+ */
+void wkc_monitor_set_expected(int expected_wkc);
+
+/**
+ * Snapshot of the counters
+ */
+void wkc_monitor_get_stats(wkc_stats *stats);
+
+#endif
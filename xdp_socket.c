@@ -0,0 +1,385 @@
+/**
+ * AF_XDP socket for EtherCAT frame exchange
+ * See xdp_socket.h for an overview.
+ *
+ * Only the kernel UAPI is used (no libbpf/libxdp): the redirect program is
+ * fifteen hand-assembled eBPF instructions, loaded with bpf(2) and attached
+ * through a BPF link so it is detached automatically if the process dies.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include "xdp_socket.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+
+#define ETH_P_ECAT 0x88A4
+
+// eBPF instruction encoding helpers
+#define INSN(c, d, s, o, i) ((struct bpf_insn){ .code = (c), .dst_reg = (d), .src_reg = (s), .off = (o), .imm = (i) })
+#define LDX_MEM(sz, d, s, o)  INSN(BPF_LDX | BPF_MEM | (sz), d, s, o, 0)
+#define MOV64_REG(d, s)       INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define MOV64_IMM(d, i)       INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define ADD64_IMM(d, i)       INSN(BPF_ALU64 | BPF_ADD | BPF_K, d, 0, 0, i)
+#define JGT_REG(d, s, o)      INSN(BPF_JMP | BPF_JGT | BPF_X, d, s, o, 0)
+#define JNE_IMM(d, i, o)      INSN(BPF_JMP | BPF_JNE | BPF_K, d, 0, o, i)
+#define CALL(f)               INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define EXIT()                INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+static long sys_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+/**
+ * Load the redirect program:
+ *   if (frame is EtherCAT) return bpf_redirect_map(xsks, rx_queue_index, XDP_PASS);
+ *   return XDP_PASS;
+ */
+static int load_redirect_prog(int map_fd)
+{
+    struct bpf_insn prog[] = {
+        LDX_MEM(BPF_W, 2, 1, offsetof(struct xdp_md, data)),
+        LDX_MEM(BPF_W, 3, 1, offsetof(struct xdp_md, data_end)),
+        MOV64_REG(4, 2),
+        ADD64_IMM(4, 14),
+        JGT_REG(4, 3, 8),                           // Runt frame -> pass
+        LDX_MEM(BPF_H, 4, 2, 12),
+        JNE_IMM(4, htons(ETH_P_ECAT), 6),           // Not EtherCAT -> pass
+        LDX_MEM(BPF_W, 2, 1, offsetof(struct xdp_md, rx_queue_index)),
+        INSN(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, map_fd),
+        INSN(0, 0, 0, 0, 0),
+        MOV64_IMM(3, XDP_PASS),
+        CALL(BPF_FUNC_redirect_map),
+        EXIT(),
+        MOV64_IMM(0, XDP_PASS),
+        EXIT(),
+    };
+    union bpf_attr attr;
+    static char log[4096];
+
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (uint64_t)(unsigned long)prog;
+    attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+    attr.license = (uint64_t)(unsigned long)"GPL";
+    attr.log_buf = (uint64_t)(unsigned long)log;
+    attr.log_size = sizeof(log);
+    attr.log_level = 1;
+
+    int fd = sys_bpf(BPF_PROG_LOAD, &attr);
+    if (fd < 0)
+        fprintf(stderr, "XDP: program load failed: %s\n%s", strerror(errno), log);
+    return fd;
+}
+
+static int attach_prog(xdp_socket *xsk)
+{
+    union bpf_attr attr;
+
+    // Native (driver) mode first, generic SKB mode as fallback
+    uint32_t modes[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+    for (int i = 0; i < 2; i++)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd = xsk->prog_fd;
+        attr.link_create.target_ifindex = xsk->ifindex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = modes[i];
+
+        xsk->link_fd = sys_bpf(BPF_LINK_CREATE, &attr);
+        if (xsk->link_fd >= 0)
+        {
+            xsk->driver_mode = (modes[i] == XDP_FLAGS_DRV_MODE);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "XDP: attach failed: %s\n", strerror(errno));
+    return -1;
+}
+
+static int map_ring(xdp_socket *xsk, xdp_ring *ring, struct xdp_ring_offset *off,
+                    size_t entry_size, off_t pgoff)
+{
+    ring->map_len = off->desc + XDP_RING_SIZE * entry_size;
+    ring->map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, xsk->fd, pgoff);
+    if (ring->map == MAP_FAILED)
+    {
+        ring->map = NULL;
+        return -1;
+    }
+
+    ring->producer = (uint32_t *)((uint8_t *)ring->map + off->producer);
+    ring->consumer = (uint32_t *)((uint8_t *)ring->map + off->consumer);
+    ring->flags = (uint32_t *)((uint8_t *)ring->map + off->flags);
+    ring->desc = (uint8_t *)ring->map + off->desc;
+    return 0;
+}
+
+static int bind_socket(xdp_socket *xsk, int flags)
+{
+    struct sockaddr_xdp sxdp;
+    uint16_t attempts[3];
+    int n = 0;
+
+    if (!(flags & XDP_SOCKET_FORCE_COPY) && xsk->driver_mode)
+        attempts[n++] = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+    attempts[n++] = XDP_COPY | XDP_USE_NEED_WAKEUP;
+    attempts[n++] = XDP_COPY;
+
+    for (int i = 0; i < n; i++)
+    {
+        memset(&sxdp, 0, sizeof(sxdp));
+        sxdp.sxdp_family = AF_XDP;
+        sxdp.sxdp_ifindex = xsk->ifindex;
+        sxdp.sxdp_queue_id = xsk->queue;
+        sxdp.sxdp_flags = attempts[i];
+
+        if (bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == 0)
+        {
+            xsk->zerocopy = (attempts[i] & XDP_ZEROCOPY) != 0;
+            xsk->need_wakeup = (attempts[i] & XDP_USE_NEED_WAKEUP) != 0;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "XDP: bind to queue %d failed: %s\n", xsk->queue, strerror(errno));
+    return -1;
+}
+
+int xdp_socket_open(xdp_socket *xsk, const char *ifname, int queue, int flags)
+{
+    struct xdp_umem_reg mr;
+    struct xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    union bpf_attr attr;
+    int size = XDP_RING_SIZE;
+    int opt;
+
+    memset(xsk, 0, sizeof(*xsk));
+    xsk->fd = xsk->prog_fd = xsk->map_fd = xsk->link_fd = -1;
+    xsk->queue = queue;
+
+    xsk->ifindex = if_nametoindex(ifname);
+    if (xsk->ifindex == 0)
+    {
+        fprintf(stderr, "XDP: unknown interface %s\n", ifname);
+        return -1;
+    }
+
+    xsk->fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xsk->fd < 0)
+    {
+        fprintf(stderr, "XDP: socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // Pre-allocate and pre-fault the whole UMEM so the cyclic path never page-faults
+    xsk->umem_len = (size_t)XDP_NUM_FRAMES * XDP_FRAME_SIZE;
+    xsk->umem = mmap(NULL, xsk->umem_len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (xsk->umem == MAP_FAILED)
+    {
+        xsk->umem = NULL;
+        fprintf(stderr, "XDP: UMEM allocation failed: %s\n", strerror(errno));
+        goto fail;
+    }
+    mlock(xsk->umem, xsk->umem_len);
+
+    memset(&mr, 0, sizeof(mr));
+    mr.addr = (uint64_t)(unsigned long)xsk->umem;
+    mr.len = xsk->umem_len;
+    mr.chunk_size = XDP_FRAME_SIZE;
+    if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING, &size, sizeof(size)) ||
+        getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen))
+    {
+        fprintf(stderr, "XDP: UMEM/ring setup failed: %s\n", strerror(errno));
+        goto fail;
+    }
+
+    if (map_ring(xsk, &xsk->fill, &off.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) ||
+        map_ring(xsk, &xsk->comp, &off.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) ||
+        map_ring(xsk, &xsk->rx, &off.rx, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING) ||
+        map_ring(xsk, &xsk->tx, &off.tx, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING))
+    {
+        fprintf(stderr, "XDP: ring mmap failed: %s\n", strerror(errno));
+        goto fail;
+    }
+
+    // First half of the UMEM feeds the fill ring, second half is the TX pool
+    uint64_t *fill = xsk->fill.desc;
+    for (int i = 0; i < XDP_RING_SIZE; i++)
+        fill[i] = (uint64_t)i * XDP_FRAME_SIZE;
+    __atomic_store_n(xsk->fill.producer, XDP_RING_SIZE, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < XDP_NUM_FRAMES / 2; i++)
+        xsk->free_tx[i] = (uint64_t)(XDP_RING_SIZE + i) * XDP_FRAME_SIZE;
+    xsk->free_tx_count = XDP_NUM_FRAMES / 2;
+
+    // XSKMAP: rx queue index -> socket
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = 64;
+    xsk->map_fd = sys_bpf(BPF_MAP_CREATE, &attr);
+    if (xsk->map_fd < 0)
+    {
+        fprintf(stderr, "XDP: map create failed: %s\n", strerror(errno));
+        goto fail;
+    }
+
+    xsk->prog_fd = load_redirect_prog(xsk->map_fd);
+    if (xsk->prog_fd < 0)
+        goto fail;
+
+    if (attach_prog(xsk) || bind_socket(xsk, flags))
+        goto fail;
+
+    uint32_t key = queue;
+    uint32_t value = xsk->fd;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = xsk->map_fd;
+    attr.key = (uint64_t)(unsigned long)&key;
+    attr.value = (uint64_t)(unsigned long)&value;
+    if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr))
+    {
+        fprintf(stderr, "XDP: map update failed: %s\n", strerror(errno));
+        goto fail;
+    }
+
+    // Let recvfrom()/sendto() kicks busy-poll the NIC queue instead of waiting for IRQs
+    opt = 1;
+    setsockopt(xsk->fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt));
+    opt = 20;
+    setsockopt(xsk->fd, SOL_SOCKET, SO_BUSY_POLL, &opt, sizeof(opt));
+    opt = 16;
+    setsockopt(xsk->fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &opt, sizeof(opt));
+
+    return 0;
+
+fail:
+    xdp_socket_close(xsk);
+    return -1;
+}
+
+void xdp_socket_close(xdp_socket *xsk)
+{
+    if (xsk->link_fd >= 0)
+        close(xsk->link_fd);
+    if (xsk->prog_fd >= 0)
+        close(xsk->prog_fd);
+    if (xsk->map_fd >= 0)
+        close(xsk->map_fd);
+
+    xdp_ring *rings[] = { &xsk->fill, &xsk->comp, &xsk->rx, &xsk->tx };
+    for (int i = 0; i < 4; i++)
+    {
+        if (rings[i]->map)
+            munmap(rings[i]->map, rings[i]->map_len);
+        rings[i]->map = NULL;
+    }
+
+    if (xsk->fd >= 0)
+        close(xsk->fd);
+    if (xsk->umem)
+        munmap(xsk->umem, xsk->umem_len);
+
+    xsk->fd = xsk->prog_fd = xsk->map_fd = xsk->link_fd = -1;
+    xsk->umem = NULL;
+}
+
+// Return completed TX frames to the free pool
+static void reclaim_tx(xdp_socket *xsk)
+{
+    uint32_t prod = __atomic_load_n(xsk->comp.producer, __ATOMIC_ACQUIRE);
+    uint32_t cons = *xsk->comp.consumer;
+    uint64_t *comp = xsk->comp.desc;
+
+    while (cons != prod)
+    {
+        xsk->free_tx[xsk->free_tx_count++] = comp[cons & (XDP_RING_SIZE - 1)];
+        cons++;
+    }
+    __atomic_store_n(xsk->comp.consumer, cons, __ATOMIC_RELEASE);
+}
+
+int xdp_socket_send(xdp_socket *xsk, const void *frame, int len)
+{
+    reclaim_tx(xsk);
+
+    if (xsk->free_tx_count == 0 || len > XDP_FRAME_SIZE)
+        return -1;
+
+    uint32_t prod = *xsk->tx.producer;
+    if (prod - __atomic_load_n(xsk->tx.consumer, __ATOMIC_ACQUIRE) >= XDP_RING_SIZE)
+        return -1;
+
+    uint64_t addr = xsk->free_tx[--xsk->free_tx_count];
+    memcpy(xsk->umem + addr, frame, len);
+
+    struct xdp_desc *desc = &((struct xdp_desc *)xsk->tx.desc)[prod & (XDP_RING_SIZE - 1)];
+    desc->addr = addr;
+    desc->len = len;
+    desc->options = 0;
+    __atomic_store_n(xsk->tx.producer, prod + 1, __ATOMIC_RELEASE);
+
+    if (!xsk->need_wakeup || (*xsk->tx.flags & XDP_RING_NEED_WAKEUP))
+        sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+
+    return len;
+}
+
+int xdp_socket_recv(xdp_socket *xsk, void *buf, int buflen)
+{
+    uint32_t prod = __atomic_load_n(xsk->rx.producer, __ATOMIC_ACQUIRE);
+    uint32_t cons = *xsk->rx.consumer;
+
+    if (prod == cons)
+    {
+        // Nothing yet: in need-wakeup mode the kernel only polls the queue when asked
+        if (!xsk->need_wakeup || (*xsk->fill.flags & XDP_RING_NEED_WAKEUP))
+            recvfrom(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+        return 0;
+    }
+
+    struct xdp_desc *desc = &((struct xdp_desc *)xsk->rx.desc)[cons & (XDP_RING_SIZE - 1)];
+    uint64_t addr = desc->addr;
+    int len = (int)desc->len < buflen ? (int)desc->len : buflen;
+    memcpy(buf, xsk->umem + addr, len);
+    __atomic_store_n(xsk->rx.consumer, cons + 1, __ATOMIC_RELEASE);
+
+    // Hand the chunk straight back to the kernel
+    uint32_t fprod = *xsk->fill.producer;
+    ((uint64_t *)xsk->fill.desc)[fprod & (XDP_RING_SIZE - 1)] = addr & ~((uint64_t)XDP_FRAME_SIZE - 1);
+    __atomic_store_n(xsk->fill.producer, fprod + 1, __ATOMIC_RELEASE);
+
+    return len;
+}
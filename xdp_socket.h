@@ -0,0 +1,88 @@
+/**
+ * AF_XDP socket for EtherCAT frame exchange
+ *
+ * Binds an XDP socket to one RX queue of a network interface and attaches
+ * a small XDP program that redirects EtherCAT frames (EtherType 0x88A4)
+ * into it; all other traffic continues to the kernel stack.
+ *
+ * The UMEM (packet buffer area shared with the kernel) is allocated,
+ * locked and pre-faulted once in xdp_socket_open(). xdp_socket_send() and
+ * xdp_socket_recv() never allocate and never block, so the cyclic task
+ * can busy-poll the rings directly.
+ *
+ * This file has no SOEM dependency; see ec_link.c for the SOEM glue.
+ */
+
+#ifndef XDP_SOCKET_H
+#define XDP_SOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define XDP_NUM_FRAMES  256     // UMEM frames, half for RX and half for TX
+#define XDP_FRAME_SIZE  2048    // One Ethernet frame per UMEM chunk
+#define XDP_RING_SIZE   (XDP_NUM_FRAMES / 2)
+
+// xdp_socket_open() flags
+#define XDP_SOCKET_FORCE_COPY  0x1   // Skip the zero-copy bind attempt
+
+typedef struct
+{
+    uint32_t *producer;
+    uint32_t *consumer;
+    uint32_t *flags;
+    void     *desc;
+    void     *map;
+    size_t    map_len;
+} xdp_ring;
+
+typedef struct
+{
+    int       fd;
+    int       ifindex;
+    int       queue;
+    int       zerocopy;         // 1 if bound with XDP_ZEROCOPY
+    int       driver_mode;      // 1 if the XDP program runs in the driver
+    int       need_wakeup;      // 1 if bound with XDP_USE_NEED_WAKEUP
+
+    int       prog_fd;
+    int       map_fd;
+    int       link_fd;
+
+    uint8_t  *umem;
+    size_t    umem_len;
+
+    xdp_ring  fill;
+    xdp_ring  comp;
+    xdp_ring  rx;
+    xdp_ring  tx;
+
+    uint64_t  free_tx[XDP_NUM_FRAMES / 2];
+    int       free_tx_count;
+} xdp_socket;
+
+/**
+ * Open an XDP socket on queue `queue` of `ifname`
+ * Tries zero-copy first unless XDP_SOCKET_FORCE_COPY is given.
+ * Returns 0 on success, -1 on failure (reason printed to stderr).
+ */
+int xdp_socket_open(xdp_socket *xsk, const char *ifname, int queue, int flags);
+
+/**
+ * Detach the XDP program and release the socket and UMEM
+ */
+void xdp_socket_close(xdp_socket *xsk);
+
+/**
+ * Queue one frame for transmission and kick the driver if needed
+ * Returns the number of bytes queued, or -1 if no TX buffer is free.
+ */
+int xdp_socket_send(xdp_socket *xsk, const void *frame, int len);
+
+/**
+ * Take one received frame from the RX ring, if any
+ * Returns the frame length copied to `buf`, or 0 if the ring is empty.
+ */
+int xdp_socket_recv(xdp_socket *xsk, void *buf, int buflen);
+
+#endif